@@ -0,0 +1,134 @@
+use std::io::Cursor;
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+
+/// Builds an in-memory pak containing `entries` copies of `data` under
+/// generated paths, zero-padded so they are written in sorted order and the
+/// setup cost stays out of what the benchmarks measure.
+fn build_pak(
+    entries: usize,
+    data: &[u8],
+    compression: Option<repak::Compression>,
+) -> Vec<u8> {
+    let mut pak = repak::PakWriter::new(
+        Cursor::new(vec![]),
+        None,
+        repak::Version::V11,
+        "../../../".to_string(),
+        Some(0),
+    );
+    if let Some(compression) = compression {
+        pak.set_compression(Some(compression)).unwrap();
+    }
+    for i in 0..entries {
+        pak.write_file(
+            &format!("content/chunk_{i:07}.uasset"),
+            &mut Cursor::new(data),
+        )
+        .unwrap();
+    }
+    pak.write_index().unwrap().into_inner()
+}
+
+/// Compressible but not trivially so, to keep Zlib honest.
+fn test_data(len: usize) -> Vec<u8> {
+    (0..len).map(|i| (i % 251) as u8 ^ (i / 251) as u8).collect()
+}
+
+fn index_parse(c: &mut Criterion) {
+    let mut group = c.benchmark_group("index_parse");
+    group.sample_size(10);
+    for entries in [1_000, 100_000, 1_000_000] {
+        let buf = build_pak(entries, &[], None);
+        group.throughput(Throughput::Elements(entries as u64));
+        group.bench_with_input(BenchmarkId::new("new_any", entries), &buf, |b, buf| {
+            b.iter(|| repak::PakReader::new_any(Cursor::new(buf), None).unwrap())
+        });
+        group.bench_with_input(BenchmarkId::new("new_any_lazy", entries), &buf, |b, buf| {
+            b.iter(|| repak::PakReader::new_any_lazy(Cursor::new(buf), None).unwrap())
+        });
+    }
+    group.finish();
+}
+
+fn read_file(c: &mut Criterion) {
+    let mut group = c.benchmark_group("read_file");
+    for size in [0x10000, 0x100000, 0x1000000] {
+        let data = test_data(size);
+        group.throughput(Throughput::Bytes(size as u64));
+        for (name, compression) in [("stored", None), ("zlib", Some(repak::Compression::Zlib))] {
+            let buf = build_pak(1, &data, compression);
+            let pak = repak::PakReader::new_any(Cursor::new(&buf), None).unwrap();
+            group.bench_function(BenchmarkId::new(name, size), |b| {
+                let mut reader = Cursor::new(&buf);
+                let mut out = Vec::with_capacity(size);
+                b.iter(|| {
+                    out.clear();
+                    pak.read_file("content/chunk_0000000.uasset", &mut reader, &mut out)
+                        .unwrap()
+                })
+            });
+        }
+    }
+    group.finish();
+
+    // there is no write-side encryption yet, so the encrypted case reads the
+    // (small) test fixture instead of a synthetic entry
+    let mut group = c.benchmark_group("read_file_encrypted");
+    let buf = std::fs::read("tests/packs/pack_v11_encrypt.pak").unwrap();
+    let pak = repak::PakReader::new_any(Cursor::new(&buf), Some(aes_key())).unwrap();
+    group.bench_function("fixture", |b| {
+        let mut reader = Cursor::new(&buf);
+        b.iter(|| {
+            for path in pak.files() {
+                pak.get(&path, &mut reader).unwrap();
+            }
+        })
+    });
+    group.finish();
+}
+
+fn aes_key() -> aes::Aes256 {
+    use aes::cipher::KeyInit;
+    use base64::{engine::general_purpose, Engine as _};
+    let bytes = general_purpose::STANDARD
+        .decode("lNJbw660IOC+kU7cnVQ1oeqrXyhk4J6UAZrCBbcnp94=")
+        .unwrap();
+    aes::Aes256::new_from_slice(&bytes).unwrap()
+}
+
+fn pack(c: &mut Criterion) {
+    let mut group = c.benchmark_group("pack");
+    group.sample_size(20);
+    const FILES: usize = 100;
+    const SIZE: usize = 0x10000;
+    let data = test_data(SIZE);
+    group.throughput(Throughput::Bytes((FILES * SIZE) as u64));
+    for (name, compression) in [("stored", None), ("zlib", Some(repak::Compression::Zlib))] {
+        group.bench_function(name, |b| b.iter(|| build_pak(FILES, &data, compression)));
+    }
+    group.finish();
+}
+
+fn unpack(c: &mut Criterion) {
+    let mut group = c.benchmark_group("unpack");
+    const FILES: usize = 100;
+    const SIZE: usize = 0x10000;
+    let buf = build_pak(FILES, &test_data(SIZE), None);
+    let pak = repak::PakReader::new_any(Cursor::new(&buf), None).unwrap();
+    group.throughput(Throughput::Bytes((FILES * SIZE) as u64));
+    group.bench_function("stored", |b| {
+        let mut reader = Cursor::new(&buf);
+        let mut out = Vec::with_capacity(SIZE);
+        b.iter(|| {
+            for path in pak.files() {
+                out.clear();
+                pak.read_file(&path, &mut reader, &mut out).unwrap();
+            }
+        })
+    });
+    group.finish();
+}
+
+criterion_group!(benches, index_parse, read_file, pack, unpack);
+criterion_main!(benches);
@@ -8,7 +8,7 @@ pub enum EntryLocation {
     Index,
 }
 
-#[derive(Debug)]
+#[derive(Debug, Clone)]
 pub struct Block {
     pub start: u64,
     pub end: u64,
@@ -34,7 +34,77 @@ fn align(offset: u64) -> u64 {
     (offset + 15) & !15
 }
 
-#[derive(Debug)]
+fn decrypt(key: Option<&aes::Aes256>, bytes: &mut [u8]) -> Result<(), super::Error> {
+    let Some(key) = key else {
+        return Err(super::Error::Encrypted);
+    };
+    super::crypto::decrypt(key, bytes);
+    Ok(())
+}
+
+/// Where an entry's stored bytes come from: a seekable reader, the whole pak
+/// already in memory (e.g. a memory mapping), or a shared positional reader.
+pub(crate) enum EntryData<'d, R> {
+    Reader(&'d mut R),
+    Slice(&'d [u8]),
+    ReadAt(&'d dyn super::ext::ReadAt),
+    /// Like `ReadAt`, but an in-memory window over a batch span whose disk
+    /// read was already timed; span copies out of it are not attributed to
+    /// the read phase a second time.
+    Window(&'d dyn super::ext::ReadAt),
+}
+
+impl<R: io::Read + io::Seek> EntryData<'_, R> {
+    /// Returns the stored bytes at `offset`, borrowing from the source where
+    /// possible and reading through `scratch` otherwise.
+    fn read_span<'s>(
+        &'s mut self,
+        offset: u64,
+        len: u64,
+        scratch: &'s mut Vec<u8>,
+    ) -> Result<&'s [u8], super::Error> {
+        match self {
+            EntryData::Reader(_) | EntryData::ReadAt(_) | EntryData::Window(_) => {
+                self.read_span_into(offset, len, scratch)?;
+                Ok(scratch)
+            }
+            EntryData::Slice(data) => data
+                .get(offset as usize..(offset + len) as usize)
+                .ok_or_else(|| super::Error::Other("entry data out of bounds".to_owned())),
+        }
+    }
+
+    /// Copies the stored bytes at `offset` into `scratch`.
+    fn read_span_into(
+        &mut self,
+        offset: u64,
+        len: u64,
+        scratch: &mut Vec<u8>,
+    ) -> Result<(), super::Error> {
+        scratch.resize(len as usize, 0);
+        let timer = match self {
+            EntryData::Window(_) => super::stats::Timer::off(),
+            _ => super::stats::timer(),
+        };
+        match self {
+            EntryData::Reader(reader) => {
+                reader.seek(io::SeekFrom::Start(offset))?;
+                reader.read_exact(scratch)?;
+            }
+            EntryData::Slice(data) => scratch.copy_from_slice(
+                data.get(offset as usize..(offset + len) as usize)
+                    .ok_or_else(|| super::Error::Other("entry data out of bounds".to_owned()))?,
+            ),
+            EntryData::ReadAt(reader) | EntryData::Window(reader) => {
+                reader.read_exact_at(scratch, offset)?
+            }
+        }
+        timer.stop(super::stats::Phase::Read, len);
+        Ok(())
+    }
+}
+
+#[derive(Debug, Clone)]
 pub struct Entry {
     pub offset: u64,
     pub compressed: u64,
@@ -310,6 +380,35 @@ impl Entry {
         })
     }
 
+    /// Absolute file offset and stored (unpadded) length of each compression
+    /// block, or a single span covering the whole data region when the entry
+    /// has no block table.
+    fn block_spans(&self, version: Version, data_offset: u64) -> Vec<(u64, u64)> {
+        match &self.blocks {
+            Some(blocks) => blocks
+                .iter()
+                .map(
+                    |block| match version.version_major() >= VersionMajor::RelativeChunkOffsets {
+                        true => (self.offset + block.start, block.end - block.start),
+                        false => (block.start, block.end - block.start),
+                    },
+                )
+                .collect(),
+            None => vec![(data_offset, self.compressed)],
+        }
+    }
+
+    /// Offset of the entry's data region, past the data-region copy of the
+    /// entry header.
+    pub(crate) fn data_offset(&self, version: Version) -> u64 {
+        self.offset
+            + Entry::get_serialized_size(
+                version,
+                self.compression,
+                self.blocks.as_ref().map_or(0, |b| b.len() as u32),
+            )
+    }
+
     pub fn read_file<R: io::Read + io::Seek, W: io::Write>(
         &self,
         reader: &mut R,
@@ -321,141 +420,303 @@ impl Entry {
         reader.seek(io::SeekFrom::Start(self.offset))?;
         Entry::read(reader, version)?;
         let data_offset = reader.stream_position()?;
-        let mut data = reader.read_len(match self.is_encrypted() {
-            true => align(self.compressed),
-            false => self.compressed,
-        } as usize)?;
-        if self.is_encrypted() {
-            let Some(key) = key else {
-                return Err(super::Error::Encrypted);
-            };
-            use aes::cipher::BlockDecrypt;
-            for block in data.chunks_mut(16) {
-                key.decrypt_block(aes::Block::from_mut_slice(block))
+        self.decompress(
+            &mut EntryData::Reader(reader),
+            data_offset,
+            version,
+            compression,
+            key,
+            buf,
+        )
+    }
+
+    /// Reads an entry through a shared positional reader. The data-region
+    /// entry header is not re-read since the index entry already determines
+    /// the data offset.
+    pub(crate) fn read_file_at<W: io::Write>(
+        &self,
+        reader: &dyn super::ext::ReadAt,
+        version: Version,
+        compression: &[Compression],
+        key: Option<&aes::Aes256>,
+        buf: &mut W,
+    ) -> Result<(), super::Error> {
+        self.decompress(
+            &mut EntryData::<io::Empty>::ReadAt(reader),
+            self.data_offset(version),
+            version,
+            compression,
+            key,
+            buf,
+        )
+    }
+
+    /// Like [`Entry::read_file_at`], but for an in-memory window over a
+    /// batch span that was already read (and timed) in one go; copies out
+    /// of the window don't count towards the read phase again.
+    pub(crate) fn read_file_window<W: io::Write>(
+        &self,
+        reader: &dyn super::ext::ReadAt,
+        version: Version,
+        compression: &[Compression],
+        key: Option<&aes::Aes256>,
+        buf: &mut W,
+    ) -> Result<(), super::Error> {
+        self.decompress(
+            &mut EntryData::<io::Empty>::Window(reader),
+            self.data_offset(version),
+            version,
+            compression,
+            key,
+            buf,
+        )
+    }
+
+    /// Reads an entry out of a fully loaded (e.g. memory mapped) pak,
+    /// borrowing stored bytes directly instead of copying where possible. The
+    /// data-region entry header is not re-parsed since the index entry
+    /// already determines the data offset.
+    pub(crate) fn read_file_slice<W: io::Write>(
+        &self,
+        file: &[u8],
+        version: Version,
+        compression: &[Compression],
+        key: Option<&aes::Aes256>,
+        buf: &mut W,
+    ) -> Result<(), super::Error> {
+        self.decompress(
+            &mut EntryData::<io::Empty>::Slice(file),
+            self.data_offset(version),
+            version,
+            compression,
+            key,
+            buf,
+        )
+    }
+
+    /// The entry's recorded SHA-1 over its stored bytes, from the index
+    /// entry when it carries one or from the data-region copy of the entry
+    /// header otherwise (V10+ index entries don't record the hash).
+    pub(crate) fn stored_hash(
+        &self,
+        reader: &dyn super::ext::ReadAt,
+        version: Version,
+    ) -> Result<[u8; 20], super::Error> {
+        match self.hash {
+            Some(hash) => Ok(hash),
+            None => {
+                let size = Entry::get_serialized_size(
+                    version,
+                    self.compression,
+                    self.blocks.as_ref().map_or(0, |b| b.len() as u32),
+                );
+                let mut header = vec![0; size as usize];
+                reader.read_exact_at(&mut header, self.offset)?;
+                Ok(Entry::read(&mut io::Cursor::new(header), version)?
+                    .hash
+                    .expect("data-region entry header carries a hash"))
             }
-            data.truncate(self.compressed as usize);
         }
+    }
 
-        let ranges = match &self.blocks {
-            Some(blocks) => blocks
-                .iter()
-                .map(
-                    |block| match version.version_major() >= VersionMajor::RelativeChunkOffsets {
-                        true => {
-                            (block.start - (data_offset - self.offset)) as usize
-                                ..(block.end - (data_offset - self.offset)) as usize
-                        }
-                        false => {
-                            (block.start - data_offset) as usize..(block.end - data_offset) as usize
-                        }
-                    },
-                )
-                .collect::<Vec<_>>(),
-            None => vec![0..data.len()],
-        };
+    /// Checks the entry's stored bytes against its recorded SHA-1. The hash
+    /// covers the `compressed` bytes at the data offset exactly as written
+    /// (still compressed and encrypted), so no key is needed.
+    pub(crate) fn verify(
+        &self,
+        reader: &dyn super::ext::ReadAt,
+        version: Version,
+        context: &str,
+    ) -> Result<(), super::Error> {
+        use sha1::{Digest, Sha1};
+        let expected = self.stored_hash(reader, version)?;
+
+        let mut hasher = Sha1::new();
+        let mut scratch = super::pool::scratch();
+        scratch.resize(self.compressed.min(0x10000) as usize, 0);
+        let mut pos = self.data_offset(version);
+        let mut remaining = self.compressed;
+        while remaining > 0 {
+            let chunk = remaining.min(scratch.len() as u64) as usize;
+            reader.read_exact_at(&mut scratch[..chunk], pos)?;
+            hasher.update(&scratch[..chunk]);
+            pos += chunk as u64;
+            remaining -= chunk as u64;
+        }
+        let got: [u8; 20] = hasher.finalize().into();
+        if got != expected {
+            return Err(super::Error::HashMismatch {
+                context: context.to_owned(),
+                expected: super::pak::hex(&expected),
+                got: super::pak::hex(&got),
+            });
+        }
+        Ok(())
+    }
+
+    /// Reads the entry's stored (still-compressed) bytes verbatim,
+    /// decrypting and stripping block padding if needed, so they can be fed
+    /// back through a writer without a decompress/recompress cycle.
+    pub(crate) fn read_raw<R: io::Read + io::Seek>(
+        &self,
+        reader: &mut R,
+        version: Version,
+        key: Option<&aes::Aes256>,
+    ) -> Result<Vec<u8>, super::Error> {
+        if self.is_encrypted() && key.is_none() {
+            return Err(super::Error::Encrypted);
+        }
+        let mut source = EntryData::Reader(reader);
+        let mut data = Vec::with_capacity(self.compressed as usize);
+        let mut scratch = super::pool::scratch();
+        for (offset, len) in self.block_spans(version, self.data_offset(version)) {
+            if self.is_encrypted() {
+                source.read_span_into(offset, align(len), &mut scratch)?;
+                decrypt(key, &mut scratch)?;
+                scratch.truncate(len as usize);
+                data.extend_from_slice(&scratch);
+            } else {
+                data.extend_from_slice(source.read_span(offset, len, &mut scratch)?);
+            }
+        }
+        Ok(data)
+    }
+
+    fn decompress<R: io::Read + io::Seek, W: io::Write>(
+        &self,
+        source: &mut EntryData<R>,
+        data_offset: u64,
+        version: Version,
+        compression: &[Compression],
+        key: Option<&aes::Aes256>,
+        buf: &mut W,
+    ) -> Result<(), super::Error> {
+        if self.is_encrypted() && key.is_none() {
+            return Err(super::Error::Encrypted);
+        }
+
+        let spans = self.block_spans(version, data_offset);
+
+        // pooled scratch buffer reused for every block (and across entries
+        // on this thread) so peak memory stays around one compression block
+        // regardless of entry size
+        let mut scratch = super::pool::scratch();
+
+        // reads the stored bytes of a span, decrypting through the scratch
+        // buffer if needed and borrowing from the source otherwise
+        fn read_span<'s, R: io::Read + io::Seek>(
+            entry: &Entry,
+            source: &'s mut EntryData<R>,
+            offset: u64,
+            len: u64,
+            key: Option<&aes::Aes256>,
+            scratch: &'s mut Vec<u8>,
+        ) -> Result<&'s [u8], super::Error> {
+            if entry.is_encrypted() {
+                source.read_span_into(offset, align(len), scratch)?;
+                decrypt(key, scratch)?;
+                scratch.truncate(len as usize);
+                Ok(scratch)
+            } else {
+                source.read_span(offset, len, scratch)
+            }
+        }
+
+        // streams a decompressor's output to `buf` through a pooled
+        // fixed-size chunk buffer, so the inflate and the output write are
+        // timed as separate phases instead of the write syscalls hiding
+        // inside the decompress timer
+        fn copy_chunked<W: io::Write>(
+            mut decoder: impl io::Read,
+            compression: Compression,
+            buf: &mut W,
+        ) -> Result<(), super::Error> {
+            let mut out = super::pool::scratch();
+            out.resize(0x10000, 0);
+            loop {
+                let timer = super::stats::timer();
+                let n = decoder.read(&mut out)?;
+                timer.stop(super::stats::Phase::Decompress(compression), n as u64);
+                if n == 0 {
+                    return Ok(());
+                }
+                let timer = super::stats::timer();
+                buf.write_all(&out[..n])?;
+                timer.stop(super::stats::Phase::Write, n as u64);
+            }
+        }
 
         macro_rules! decompress {
-            ($decompressor: ty) => {
-                for range in ranges {
-                    io::copy(&mut <$decompressor>::new(&data[range]), buf)?;
+            ($decompressor: ty, $compression: expr) => {
+                for (offset, len) in spans {
+                    let data = read_span(self, source, offset, len, key, &mut scratch)?;
+                    copy_chunked(<$decompressor>::new(data), $compression, buf)?;
                 }
             };
         }
 
         match self.compression.map(|c| compression[c as usize]) {
-            None => buf.write_all(&data)?,
-            Some(Compression::Zlib) => decompress!(flate2::read::ZlibDecoder<&[u8]>),
-            Some(Compression::Gzip) => decompress!(flate2::read::GzDecoder<&[u8]>),
-            Some(Compression::Oodle) => {
-                #[cfg(not(target_os = "windows"))]
-                return Err(super::Error::Oodle());
-
-                #[cfg(target_os = "windows")]
-                unsafe {
-                    let lib = libloading::Library::new("oo2core_9_win64.dll")
-                        .map_err(|_| super::Error::OodleMissing())?;
-
-                    /*
-                    let set_printf: libloading::Symbol<
-                        unsafe extern "C" fn(
-                            unsafe extern "C" fn(
-                                i32,
-                                *const std::ffi::c_char,
-                                i32,
-                                *const std::ffi::c_char,
-                                ...
-                            ) -> std::ffi::c_int,
-                        ),
-                    > = lib.get(b"OodleCore_Plugins_SetPrintf").unwrap();
-
-                    pub unsafe extern "C" fn printf(
-                        a: i32,
-                        b: *const std::ffi::c_char,
-                        c: i32,
-                        str: *const std::ffi::c_char,
-                        mut args: ...
-                    ) -> std::ffi::c_int {
-                        use printf_compat::{format, output};
-                        let mut s = String::new();
-                        let bytes_written = format(str, args.as_va_list(), output::fmt_write(&mut s));
-                        print!("[OODLE]: {}", s);
-                        bytes_written
-                    }
-
-                    set_printf(printf);
-                    */
-
-                    let func: libloading::Symbol<
-                        extern "C" fn(
-                            compBuf: *mut u8,
-                            compBufSize: usize,
-                            rawBuf: *mut u8,
-                            rawLen: usize,
-                            fuzzSafe: u32,
-                            checkCRC: u32,
-                            verbosity: u32,
-                            decBufBase: u64,
-                            decBufSize: usize,
-                            fpCallback: u64,
-                            callbackUserData: u64,
-                            decoderMemory: u64,
-                            decoderMemorySize: usize,
-                            threadPhase: u32,
-                        ) -> i32,
-                    > = lib.get(b"OodleLZ_Decompress").unwrap();
-
-                    let mut decompressed = vec![0; self.uncompressed as usize];
-
-                    // merge all blocks into one (assuming no odd bytes) in between
-                    // oodle does not like decompressing blocks individually
-                    let buffer = &mut data[ranges[0].start..ranges[ranges.len() - 1].end];
-                    let out = func(
-                        buffer.as_mut_ptr(),
-                        buffer.len(),
-                        decompressed.as_mut_ptr(),
-                        decompressed.len(),
-                        0,
-                        0,
-                        0, //verbose 3
-                        0,
-                        0,
-                        0,
-                        0,
-                        0,
-                        0,
-                        3,
-                    );
-                    if out == 0 {
-                        return Err(super::Error::DecompressionFailed(Compression::Oodle));
-                    } else {
-                        assert_eq!(
-                            out as u64, self.uncompressed,
-                            "Unexpected decompressed bytes"
-                        );
-                        buf.write_all(&decompressed)?;
+            None => {
+                // uncompressed entries can be arbitrarily large; stream them
+                // in fixed-size chunks rather than buffering the whole entry
+                const CHUNK: u64 = 0x10000;
+                for (offset, len) in spans {
+                    let mut pos = offset;
+                    let mut remaining = len;
+                    while remaining > 0 {
+                        let chunk = remaining.min(CHUNK);
+                        let data = read_span(self, source, pos, chunk, key, &mut scratch)?;
+                        let timer = super::stats::timer();
+                        buf.write_all(data)?;
+                        timer.stop(super::stats::Phase::Write, chunk);
+                        pos += chunk;
+                        remaining -= chunk;
                     }
                 }
             }
+            Some(Compression::Zlib) => {
+                decompress!(flate2::read::ZlibDecoder<&[u8]>, Compression::Zlib)
+            }
+            Some(Compression::Gzip) => {
+                decompress!(flate2::read::GzDecoder<&[u8]>, Compression::Gzip)
+            }
+            Some(Compression::Zstd) => {
+                for (offset, len) in spans {
+                    let data = read_span(self, source, offset, len, key, &mut scratch)?;
+                    copy_chunked(
+                        zstd::stream::read::Decoder::with_buffer(data)?,
+                        Compression::Zstd,
+                        buf,
+                    )?;
+                }
+            }
+            Some(Compression::Oodle) => {
+                let oodle = super::oodle::decompressor()?;
+
+                // merge all blocks into one (assuming no odd bytes in between)
+                // oodle does not like decompressing blocks individually
+                let (first_offset, _) = spans[0];
+                let (last_offset, last_len) = *spans.last().unwrap();
+                let merged = last_offset - first_offset + last_len;
+                let data = read_span(self, source, first_offset, merged, key, &mut scratch)?;
+
+                let mut decompressed = super::pool::scratch();
+                decompressed.resize(self.uncompressed as usize, 0);
+                let timer = super::stats::timer();
+                let out = oodle(data, &mut decompressed);
+                timer.stop(
+                    super::stats::Phase::Decompress(Compression::Oodle),
+                    self.uncompressed,
+                );
+                if out <= 0 {
+                    return Err(super::Error::DecompressionFailed(Compression::Oodle));
+                } else {
+                    assert_eq!(out as u64, self.uncompressed, "Unexpected decompressed bytes");
+                    let timer = super::stats::timer();
+                    buf.write_all(&decompressed)?;
+                    timer.stop(super::stats::Phase::Write, self.uncompressed);
+                }
+            }
             _ => todo!(),
         }
         buf.flush()?;
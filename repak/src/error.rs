@@ -32,7 +32,7 @@ pub enum Error {
     #[error("found magic of {0:#x} instead of {:#x}", super::MAGIC)]
     Magic(u32),
 
-    #[error("Oodle compression only supported on Windows (or WINE)")]
+    #[error("No Oodle decompressor registered (only loaded automatically on Windows)")]
     Oodle(),
 
     #[error("Could not find oo2core_9_win64.dll for Oodle compression")]
@@ -56,6 +56,16 @@ pub enum Error {
     #[error("{0} decompression failed")]
     DecompressionFailed(Compression),
 
+    #[error("writing {0} compressed entries is not supported")]
+    WriteCompression(Compression),
+
+    #[error("hash mismatch in {context}: expected {expected}, got {got}")]
+    HashMismatch {
+        context: String,
+        expected: String,
+        got: String,
+    },
+
     #[error("used version {used} but pak is version {version}")]
     Version {
         used: super::VersionMajor,
@@ -16,6 +16,104 @@ pub trait WriteExt {
     fn write_string(&mut self, value: &str) -> Result<(), super::Error>;
 }
 
+/// Positional (pread-style) reads that never move a cursor, so one handle
+/// can be shared across threads without locking or per-thread reopening.
+pub trait ReadAt {
+    /// Reads exactly `buf.len()` bytes starting at `offset`.
+    fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> std::io::Result<()>;
+}
+
+impl ReadAt for std::fs::File {
+    #[cfg(unix)]
+    fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> std::io::Result<()> {
+        std::os::unix::fs::FileExt::read_exact_at(self, buf, offset)
+    }
+
+    #[cfg(windows)]
+    fn read_exact_at(&self, mut buf: &mut [u8], mut offset: u64) -> std::io::Result<()> {
+        // seek_read passes the offset down via OVERLAPPED, so concurrent
+        // calls with their own offsets don't interfere
+        use std::os::windows::fs::FileExt;
+        while !buf.is_empty() {
+            match self.seek_read(buf, offset) {
+                Ok(0) => {
+                    return Err(std::io::Error::new(
+                        std::io::ErrorKind::UnexpectedEof,
+                        "failed to fill whole buffer",
+                    ))
+                }
+                Ok(n) => {
+                    buf = &mut buf[n..];
+                    offset += n as u64;
+                }
+                Err(ref e) if e.kind() == std::io::ErrorKind::Interrupted => {}
+                Err(e) => return Err(e),
+            }
+        }
+        Ok(())
+    }
+}
+
+/// A window of a larger file held in memory at `base`, readable at its
+/// original absolute offsets.
+pub(crate) struct OffsetReadAt<'d> {
+    pub data: &'d [u8],
+    pub base: u64,
+}
+
+impl ReadAt for OffsetReadAt<'_> {
+    fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> std::io::Result<()> {
+        let rel = offset.checked_sub(self.base).ok_or_else(|| {
+            std::io::Error::new(std::io::ErrorKind::InvalidInput, "read before window")
+        })?;
+        self.data.read_exact_at(buf, rel)
+    }
+}
+
+impl<T: ReadAt + ?Sized> ReadAt for &T {
+    fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> std::io::Result<()> {
+        (**self).read_exact_at(buf, offset)
+    }
+}
+
+/// [`ReadAt`] for sources whose reads complete asynchronously (e.g. network
+/// object storage), so many entry fetches can be in flight on one executor
+/// instead of one blocked OS thread each. Runtime-agnostic: implement it
+/// over whatever I/O layer the application already uses.
+pub trait AsyncReadAt {
+    /// Reads exactly `buf.len()` bytes starting at `offset`.
+    fn read_exact_at_async(
+        &self,
+        buf: &mut [u8],
+        offset: u64,
+    ) -> impl std::future::Future<Output = std::io::Result<()>> + Send;
+}
+
+/// Synchronous sources are trivially asynchronous; this lets a [`ReadAt`]
+/// (a local [`std::fs::File`], an mmap) be passed wherever an
+/// [`AsyncReadAt`] is expected.
+impl<T: ReadAt + Sync + ?Sized> AsyncReadAt for T {
+    async fn read_exact_at_async(&self, buf: &mut [u8], offset: u64) -> std::io::Result<()> {
+        self.read_exact_at(buf, offset)
+    }
+}
+
+impl ReadAt for [u8] {
+    fn read_exact_at(&self, buf: &mut [u8], offset: u64) -> std::io::Result<()> {
+        let start = offset as usize;
+        match self.get(start..start + buf.len()) {
+            Some(data) => {
+                buf.copy_from_slice(data);
+                Ok(())
+            }
+            None => Err(std::io::Error::new(
+                std::io::ErrorKind::UnexpectedEof,
+                "failed to fill whole buffer",
+            )),
+        }
+    }
+}
+
 impl<R: std::io::Read> ReadExt for R {
     fn read_bool(&mut self) -> Result<bool, super::Error> {
         match self.read_u8()? {
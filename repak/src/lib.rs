@@ -1,11 +1,25 @@
 #![allow(dead_code)]
+mod crypto;
 mod entry;
 mod error;
 mod ext;
 mod footer;
+mod mmap;
+mod oodle;
 mod pak;
+mod pool;
+pub mod stats;
+mod vfs;
 
-pub use {error::*, pak::*};
+pub use {
+    entry::{Block, Entry},
+    error::*,
+    ext::{AsyncReadAt, ReadAt},
+    mmap::*,
+    oodle::*,
+    pak::*,
+    vfs::*,
+};
 
 pub const MAGIC: u32 = 0x5A6F12E1;
 
@@ -110,11 +124,22 @@ impl Version {
     }
 }
 
-#[derive(Default, Clone, Copy, PartialEq, Eq, Debug, strum::Display, strum::EnumString)]
+#[derive(
+    Default,
+    Clone,
+    Copy,
+    PartialEq,
+    Eq,
+    Debug,
+    strum::Display,
+    strum::EnumString,
+    strum::EnumVariantNames,
+)]
 pub enum Compression {
     #[default]
     None,
     Zlib,
     Gzip,
     Oodle,
+    Zstd,
 }
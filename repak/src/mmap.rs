@@ -0,0 +1,71 @@
+use super::PakReader;
+use std::fs::File;
+use std::io;
+
+/// A [`PakReader`] backed by a memory mapping of the pak file, so entry reads
+/// come straight out of the page cache instead of seek + copy through a
+/// reader. Stored, unencrypted entries can additionally be borrowed with
+/// [`MmapPakReader::get_ref`] without any copy at all.
+#[derive(Debug)]
+pub struct MmapPakReader {
+    mmap: memmap2::Mmap,
+    pak: PakReader,
+}
+
+impl MmapPakReader {
+    pub fn new_any(file: &File, key: Option<aes::Aes256>) -> Result<Self, super::Error> {
+        // SAFETY: the caller is expected not to modify the pak while it is
+        // mapped, as with any other reader over the same file
+        let mmap = unsafe { memmap2::Mmap::map(file)? };
+        let pak = PakReader::new_any(io::Cursor::new(&mmap[..]), key)?;
+        Ok(MmapPakReader { mmap, pak })
+    }
+
+    pub fn version(&self) -> super::Version {
+        self.pak.version()
+    }
+
+    pub fn mount_point(&self) -> &str {
+        self.pak.mount_point()
+    }
+
+    pub fn files(&self) -> Vec<String> {
+        self.pak.files()
+    }
+
+    /// Borrows an entry's data straight from the mapping. Returns `None` for
+    /// compressed or encrypted entries, which cannot be served zero-copy; use
+    /// [`MmapPakReader::get`] for those.
+    pub fn get_ref(&self, path: &str) -> Result<Option<&[u8]>, super::Error> {
+        let Some(entry) = self.pak.pak.index.entry(path)? else {
+            return Err(super::Error::MissingEntry(path.to_owned()));
+        };
+        if entry.compression.is_some() || entry.is_encrypted() {
+            return Ok(None);
+        }
+        let start = entry.data_offset(self.pak.pak.version) as usize;
+        self.mmap
+            .get(start..start + entry.uncompressed as usize)
+            .map(Some)
+            .ok_or_else(|| super::Error::Other("entry data out of bounds".to_owned()))
+    }
+
+    pub fn get(&self, path: &str) -> Result<Vec<u8>, super::Error> {
+        let mut data = Vec::new();
+        self.read_file(path, &mut data)?;
+        Ok(data)
+    }
+
+    pub fn read_file<W: io::Write>(&self, path: &str, writer: &mut W) -> Result<(), super::Error> {
+        match self.pak.pak.index.entry(path)? {
+            Some(entry) => entry.read_file_slice(
+                &self.mmap,
+                self.pak.pak.version,
+                &self.pak.pak.compression,
+                self.pak.key.as_ref(),
+                writer,
+            ),
+            None => Err(super::Error::MissingEntry(path.to_owned())),
+        }
+    }
+}
@@ -0,0 +1,99 @@
+use std::sync::OnceLock;
+
+/// Decompresses `comp` into the exactly-sized `raw` buffer, returning the
+/// number of bytes written or a value <= 0 on failure (mirroring the return
+/// convention of OodleLZ_Decompress).
+pub type OodleDecompress = fn(comp: &[u8], raw: &mut [u8]) -> i32;
+
+static DECOMPRESS: OnceLock<OodleDecompress> = OnceLock::new();
+
+/// Provide an Oodle decompressor for the process, e.g. one backed by
+/// liboo2core on platforms where the DLL loader below is unavailable.
+/// May only be called once, and must be called before the first Oodle
+/// decompression to take effect.
+pub fn register_decompressor(decompress: OodleDecompress) -> Result<(), super::Error> {
+    DECOMPRESS
+        .set(decompress)
+        .map_err(|_| super::Error::Other("oodle decompressor already registered".to_owned()))
+}
+
+pub(crate) fn decompressor() -> Result<OodleDecompress, super::Error> {
+    if let Some(decompress) = DECOMPRESS.get() {
+        return Ok(*decompress);
+    }
+
+    #[cfg(not(target_os = "windows"))]
+    {
+        Err(super::Error::Oodle())
+    }
+
+    #[cfg(target_os = "windows")]
+    {
+        dll::decompressor()
+    }
+}
+
+#[cfg(target_os = "windows")]
+mod dll {
+    use super::*;
+
+    #[allow(non_camel_case_types)]
+    type OodleLZ_Decompress = extern "C" fn(
+        comp_buf: *const u8,
+        comp_buf_size: usize,
+        raw_buf: *mut u8,
+        raw_len: usize,
+        fuzz_safe: u32,
+        check_crc: u32,
+        verbosity: u32,
+        dec_buf_base: u64,
+        dec_buf_size: usize,
+        fp_callback: u64,
+        callback_user_data: u64,
+        decoder_memory: u64,
+        decoder_memory_size: usize,
+        thread_phase: u32,
+    ) -> i32;
+
+    /// Resolved once per process; the library handle is intentionally leaked
+    /// so the function pointer stays valid for the lifetime of the process.
+    static DLL_DECOMPRESS: OnceLock<Option<OodleLZ_Decompress>> = OnceLock::new();
+
+    fn load() -> Option<OodleLZ_Decompress> {
+        unsafe {
+            let lib = libloading::Library::new("oo2core_9_win64.dll").ok()?;
+            let func: libloading::Symbol<OodleLZ_Decompress> =
+                lib.get(b"OodleLZ_Decompress").ok()?;
+            let func = *func;
+            std::mem::forget(lib);
+            Some(func)
+        }
+    }
+
+    fn decompress(comp: &[u8], raw: &mut [u8]) -> i32 {
+        let func = DLL_DECOMPRESS.get().unwrap().unwrap();
+        func(
+            comp.as_ptr(),
+            comp.len(),
+            raw.as_mut_ptr(),
+            raw.len(),
+            0,
+            0,
+            0, // verbose 3
+            0,
+            0,
+            0,
+            0,
+            0,
+            0,
+            3,
+        )
+    }
+
+    pub(super) fn decompressor() -> Result<OodleDecompress, crate::Error> {
+        match DLL_DECOMPRESS.get_or_init(load) {
+            Some(_) => Ok(decompress),
+            None => Err(crate::Error::OodleMissing()),
+        }
+    }
+}
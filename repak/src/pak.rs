@@ -2,13 +2,13 @@ use super::ext::{ReadExt, WriteExt};
 use super::{Version, VersionMajor};
 use aes::Aes256;
 use byteorder::{ReadBytesExt, WriteBytesExt, LE};
-use std::collections::BTreeMap;
+use std::collections::{BTreeMap, HashMap};
 use std::io::{self, Read, Seek, Write};
 
 #[derive(Debug)]
 pub struct PakReader {
-    pak: Pak,
-    key: Option<aes::Aes256>,
+    pub(crate) pak: Pak,
+    pub(crate) key: Option<aes::Aes256>,
 }
 
 #[derive(Debug)]
@@ -16,15 +16,22 @@ pub struct PakWriter<W: Write + Seek> {
     pak: Pak,
     writer: W,
     key: Option<aes::Aes256>,
+    compression: Option<super::Compression>,
+    encrypt_data: bool,
+    encrypt_index: bool,
+    /// stored-bytes hash -> first entry written with it, kept while
+    /// deduplication is enabled
+    dedup: Option<HashMap<[u8; 20], super::entry::Entry>>,
+    data_alignment: Option<u64>,
 }
 
 #[derive(Debug)]
 pub struct Pak {
-    version: Version,
-    mount_point: String,
-    index_offset: Option<u64>,
-    index: Index,
-    compression: Vec<super::Compression>,
+    pub(crate) version: Version,
+    pub(crate) mount_point: String,
+    pub(crate) index_offset: Option<u64>,
+    pub(crate) index: Index,
+    pub(crate) compression: Vec<super::Compression>,
 }
 
 impl Pak {
@@ -42,7 +49,45 @@ impl Pak {
 #[derive(Debug, Default)]
 pub struct Index {
     path_hash_seed: Option<u64>,
-    entries: BTreeMap<String, super::entry::Entry>,
+    /// entry paths, lexicographically sorted
+    paths: Vec<String>,
+    /// entries, parallel to `paths`; a slot may still be undecoded
+    entries: Vec<EntrySlot>,
+    /// fnv64 of the lowercased UTF-16LE path -> slot in `paths`, from the
+    /// pak's own path hash index where available
+    path_hash_index: Option<HashMap<u64, u32>>,
+    /// raw encoded entry records, retained when the index was opened lazily
+    encoded_entries: Option<EncodedEntries>,
+    /// resolve lookups like the game client: by lowercase path hash, see
+    /// [`Index::set_case_insensitive`]
+    case_insensitive: bool,
+    /// entries buffered by [`Index::add_entry`] while writing, folded into
+    /// the sorted vectors by [`Index::commit_pending`]; appending here keeps
+    /// each write O(1) instead of an O(n) sorted insert
+    pending: Vec<(String, EntrySlot)>,
+}
+
+/// An entry that is decoded from the index's encoded records the first time
+/// it is accessed.
+#[derive(Debug, Default)]
+struct EntrySlot {
+    entry: std::sync::OnceLock<super::entry::Entry>,
+    encoded_offset: u32,
+}
+
+impl From<super::entry::Entry> for EntrySlot {
+    fn from(entry: super::entry::Entry) -> Self {
+        EntrySlot {
+            entry: entry.into(),
+            encoded_offset: 0,
+        }
+    }
+}
+
+#[derive(Debug)]
+struct EncodedEntries {
+    version: Version,
+    data: Vec<u8>,
 }
 
 impl Index {
@@ -53,25 +98,333 @@ impl Index {
         }
     }
 
-    fn entries(&self) -> &BTreeMap<String, super::entry::Entry> {
-        &self.entries
+    pub(crate) fn paths(&self) -> &[String] {
+        &self.paths
+    }
+
+    fn len(&self) -> usize {
+        self.paths.len()
     }
 
-    fn into_entries(self) -> BTreeMap<String, super::entry::Entry> {
-        self.entries
+    /// Iterates over the index in sorted path order without copying it.
+    pub(crate) fn iter(
+        &self,
+    ) -> impl Iterator<Item = Result<(&str, &super::entry::Entry), super::Error>> {
+        self.paths
+            .iter()
+            .enumerate()
+            .map(|(slot, path)| Ok((path.as_str(), self.entry_at(slot)?)))
+    }
+
+    /// Resolve lookups the way the game client does: paths match regardless
+    /// of case, via the lowercase fnv64 hash the path hash index already
+    /// keys on. No lowercased shadow copy of the paths is built — a pak
+    /// without a hash index (pre-V10) gets the same `u64 -> slot` map the
+    /// V10 reader computes, and candidate slots are verified by comparing
+    /// lowercased characters in place.
+    pub(crate) fn set_case_insensitive(&mut self, enabled: bool) {
+        self.case_insensitive = enabled;
+        if enabled && self.path_hash_index.is_none() {
+            let seed = self.path_hash_seed.unwrap_or(0);
+            self.path_hash_index = Some(
+                self.paths
+                    .iter()
+                    .enumerate()
+                    .map(|(slot, path)| (fnv64_path(path, seed), slot as u32))
+                    .collect(),
+            );
+        }
+    }
+
+    /// Hash-first lookup; falls back to a binary search over the sorted
+    /// paths on a hash collision or when no hash index is available.
+    pub(crate) fn entry(
+        &self,
+        path: &str,
+    ) -> Result<Option<&super::entry::Entry>, super::Error> {
+        super::stats::count_entry_lookup();
+        if let Some(index) = &self.path_hash_index {
+            let seed = self.path_hash_seed.unwrap_or(0);
+            if let Some(&slot) = index.get(&fnv64_path(path, seed)) {
+                let stored = self.paths[slot as usize].as_str();
+                if stored == path || (self.case_insensitive && eq_path_ignore_case(stored, path)) {
+                    return self.entry_at(slot as usize).map(Some);
+                }
+            }
+        }
+        if let Some(slot) = self.slot(path) {
+            return self.entry_at(slot).map(Some);
+        }
+        // last resort for case-insensitive mode: the sorted order is
+        // case-sensitive, so a hash collision leaves only a scan
+        if self.case_insensitive {
+            if let Some(slot) = self
+                .paths
+                .iter()
+                .position(|stored| eq_path_ignore_case(stored, path))
+            {
+                return self.entry_at(slot).map(Some);
+            }
+        }
+        Ok(None)
+    }
+
+    /// Entry in `slot`, decoding it from the encoded records on first access.
+    pub(crate) fn entry_at(&self, slot: usize) -> Result<&super::entry::Entry, super::Error> {
+        let s = &self.entries[slot];
+        if let Some(entry) = s.entry.get() {
+            return Ok(entry);
+        }
+        let encoded = self
+            .encoded_entries
+            .as_ref()
+            .expect("undecoded entry without encoded records");
+        let mut reader = io::Cursor::new(&encoded.data[s.encoded_offset as usize..]);
+        let entry = super::entry::Entry::read_encoded(&mut reader, encoded.version)?;
+        // losing the race to another thread is fine; the decodes are identical
+        let _ = s.entry.set(entry);
+        Ok(s.entry.get().unwrap())
+    }
+
+    fn slot(&self, path: &str) -> Option<usize> {
+        self.paths.binary_search_by(|p| p.as_str().cmp(path)).ok()
+    }
+
+    /// Slots of paths under `prefix`, matching whole path components
+    /// ("dir/sub" selects "dir/sub" itself and "dir/sub/...", but not
+    /// "dir/subx"). Resolved as a range query over the sorted paths, so
+    /// subtrees outside the prefix are never visited.
+    pub(crate) fn prefix_slots(&self, prefix: &str) -> impl Iterator<Item = usize> + '_ {
+        let bare = prefix.is_empty() || prefix.ends_with('/');
+        let exact = match bare {
+            true => None,
+            false => self.slot(prefix),
+        };
+        let dir = match bare {
+            true => prefix.to_string(),
+            false => format!("{prefix}/"),
+        };
+        let start = self.paths.partition_point(|p| p.as_str() < dir.as_str());
+        let count = self.paths[start..].partition_point(|p| p.starts_with(&dir));
+        exact.into_iter().chain(start..start + count)
     }
 
     fn add_entry(&mut self, path: &str, entry: super::entry::Entry) {
-        self.entries.insert(path.to_string(), entry);
+        self.pending.push((path.to_string(), entry.into()));
+        // slots will shift on commit; lookups aren't needed while writing
+        self.path_hash_index = None;
+    }
+
+    /// Folds the entries buffered by [`Index::add_entry`] into the sorted
+    /// parallel vectors with one sort, so writing n files in any order costs
+    /// O(n log n) total rather than an O(n) insertion each. A path written
+    /// more than once keeps its last entry, matching in-place replacement.
+    fn commit_pending(&mut self) {
+        if self.pending.is_empty() {
+            return;
+        }
+        let mut merged: Vec<_> = std::mem::take(&mut self.paths)
+            .into_iter()
+            .zip(std::mem::take(&mut self.entries))
+            .chain(std::mem::take(&mut self.pending))
+            .collect();
+        // stable sort keeps equal paths in write order; the last one wins
+        merged.sort_by(|a, b| a.0.cmp(&b.0));
+        self.paths.reserve(merged.len());
+        self.entries.reserve(merged.len());
+        for (path, entry) in merged {
+            if self.paths.last() == Some(&path) {
+                *self.entries.last_mut().unwrap() = entry;
+            } else {
+                self.paths.push(path);
+                self.entries.push(entry);
+            }
+        }
     }
 }
 
+/// Uncompressed bytes per compression block, matching UnrealPak's default.
+const COMPRESSION_BLOCK_SIZE: u32 = 0x10000;
+
+/// A run of entries adjacent on disk, planned by
+/// [`PakReader::plan_extraction`] and extracted with one sequential read.
+#[derive(Debug)]
+pub struct ExtractionBatch {
+    offset: u64,
+    size: u64,
+    paths: Vec<String>,
+    /// A single entry bigger than the planning cap; readers stream it block
+    /// by block instead of buffering its whole span.
+    oversized: bool,
+}
+
+impl ExtractionBatch {
+    pub fn paths(&self) -> &[String] {
+        &self.paths
+    }
+
+    /// Bytes read from disk for this batch.
+    pub fn size(&self) -> u64 {
+        self.size
+    }
+}
+
+/// An entry's stored bytes fetched by [`PakReader::fetch_file`] but not yet
+/// decoded, splitting the awaited I/O from the CPU work so callers can run
+/// [`FetchedEntry::decode`] on a compute pool while further fetches await.
+pub struct FetchedEntry<'p> {
+    reader: &'p PakReader,
+    entry: &'p super::entry::Entry,
+    /// stored bytes from the entry's offset, data-region header included
+    data: Vec<u8>,
+}
+
+impl FetchedEntry<'_> {
+    /// Decrypts and decompresses the fetched bytes into `writer`.
+    pub fn decode<W: Write>(&self, writer: &mut W) -> Result<(), super::Error> {
+        let window = super::ext::OffsetReadAt {
+            data: &self.data,
+            base: self.entry.offset,
+        };
+        self.entry.read_file_window(
+            &window,
+            self.reader.pak.version,
+            &self.reader.pak.compression,
+            self.reader.key.as_ref(),
+            writer,
+        )
+    }
+}
+
+/// A file that has been prepared for writing (the CPU-heavy part of
+/// [`PakWriter::write_file`]: hashing and compression) without touching the
+/// writer, so pack pipelines can fan the preparation out to worker threads
+/// and commit the results in order with [`PakWriter::write_partial_entry`].
+#[derive(Debug)]
+pub struct PartialEntry {
+    /// Stored bytes: compression blocks back to back, or the input verbatim
+    data: Vec<u8>,
+    uncompressed: u64,
+    compression: Option<super::Compression>,
+    block_sizes: Vec<u64>,
+    compression_block_size: u32,
+    hash: [u8; 20],
+    encrypted: bool,
+}
+
+impl PartialEntry {
+    /// Prepares a file to be stored uncompressed.
+    pub fn new(data: Vec<u8>) -> Self {
+        let hash = hash(&data);
+        let uncompressed = data.len() as u64;
+        PartialEntry {
+            data,
+            uncompressed,
+            compression: None,
+            block_sizes: vec![],
+            compression_block_size: 0,
+            hash,
+            encrypted: false,
+        }
+    }
+
+    /// Encrypts the prepared stored bytes in place (AES-256-ECB, each
+    /// compression block padded to the AES block size) and recomputes the
+    /// hash, which covers the bytes as stored. Safe to call on a worker
+    /// thread so encryption overlaps the writer's file I/O; otherwise
+    /// [`PakWriter::write_partial_entry`] encrypts on commit.
+    pub fn encrypt(&mut self, key: &Aes256) {
+        if self.encrypted {
+            return;
+        }
+        match self.compression {
+            None => pad_repeat_to_alignment(&mut self.data, 16),
+            // compression blocks are encrypted (and so padded) individually
+            Some(_) => {
+                let mut padded = Vec::with_capacity(self.data.len() + 15 * self.block_sizes.len());
+                let mut pos = 0;
+                for &size in &self.block_sizes {
+                    let mut block = self.data[pos..pos + size as usize].to_vec();
+                    pad_repeat_to_alignment(&mut block, 16);
+                    padded.extend_from_slice(&block);
+                    pos += size as usize;
+                }
+                self.data = padded;
+            }
+        }
+        super::crypto::encrypt(key, &mut self.data);
+        // the recorded size of uncompressed entries excludes the padding, and
+        // the recorded hash follows suit
+        let stored = match self.compression {
+            None => self.uncompressed as usize,
+            Some(_) => self.data.len(),
+        };
+        self.hash = hash(&self.data[..stored]);
+        self.encrypted = true;
+    }
+
+    /// Prepares a file to be stored compressed, splitting it into
+    /// compression blocks. Falls back to storing the input verbatim when
+    /// compression does not shrink it.
+    pub fn compressed(
+        data: Vec<u8>,
+        compression: super::Compression,
+    ) -> Result<Self, super::Error> {
+        let uncompressed = data.len() as u64;
+        let mut stored = vec![];
+        let mut block_sizes = vec![];
+        for chunk in data.chunks(COMPRESSION_BLOCK_SIZE as usize) {
+            let block = compress_block(compression, chunk)?;
+            block_sizes.push(block.len() as u64);
+            stored.extend_from_slice(&block);
+        }
+        if stored.len() as u64 >= uncompressed {
+            return Ok(PartialEntry::new(data));
+        }
+        let hash = hash(&stored);
+        Ok(PartialEntry {
+            data: stored,
+            uncompressed,
+            compression: Some(compression),
+            block_sizes,
+            // UnrealPak records the uncompressed size for single-block entries
+            compression_block_size: (COMPRESSION_BLOCK_SIZE as u64).min(uncompressed) as u32,
+            hash,
+            encrypted: false,
+        })
+    }
+}
+
+fn compress_block(
+    compression: super::Compression,
+    data: &[u8],
+) -> Result<Vec<u8>, super::Error> {
+    let timer = super::stats::timer();
+    let level = flate2::Compression::default();
+    let block = match compression {
+        super::Compression::Zlib => {
+            let mut encoder = flate2::write::ZlibEncoder::new(vec![], level);
+            encoder.write_all(data)?;
+            encoder.finish()?
+        }
+        super::Compression::Gzip => {
+            let mut encoder = flate2::write::GzEncoder::new(vec![], level);
+            encoder.write_all(data)?;
+            encoder.finish()?
+        }
+        super::Compression::Zstd => zstd::stream::encode_all(data, 0)?,
+        _ => return Err(super::Error::WriteCompression(compression)),
+    };
+    timer.stop(
+        super::stats::Phase::Compress(compression),
+        data.len() as u64,
+    );
+    Ok(block)
+}
+
 fn decrypt(key: &Option<aes::Aes256>, bytes: &mut [u8]) -> Result<(), super::Error> {
     if let Some(key) = &key {
-        use aes::cipher::BlockDecrypt;
-        for chunk in bytes.chunks_mut(16) {
-            key.decrypt_block(aes::Block::from_mut_slice(chunk))
-        }
+        super::crypto::decrypt(key, bytes);
         Ok(())
     } else {
         Err(super::Error::Encrypted)
@@ -80,11 +433,57 @@ fn decrypt(key: &Option<aes::Aes256>, bytes: &mut [u8]) -> Result<(), super::Err
 
 impl PakReader {
     pub fn new_any<R: Read + Seek>(
+        reader: R,
+        key: Option<aes::Aes256>,
+    ) -> Result<Self, super::Error> {
+        Self::new_any_inner(reader, key, false)
+    }
+
+    /// Like [`PakReader::new_any`], but keeps the index's encoded entry
+    /// records and decodes an entry only when it is first accessed. Prefer
+    /// this when only a few entries will be read; whole-pak operations decode
+    /// everything anyway.
+    pub fn new_any_lazy<R: Read + Seek>(
+        reader: R,
+        key: Option<aes::Aes256>,
+    ) -> Result<Self, super::Error> {
+        Self::new_any_inner(reader, key, true)
+    }
+
+    fn new_any_inner<R: Read + Seek>(
         mut reader: R,
         key: Option<aes::Aes256>,
+        lazy: bool,
     ) -> Result<Self, super::Error> {
+        // read the largest possible footer once and probe it for each
+        // version's magic, rather than paying a seek + index read per
+        // candidate version
+        let len = reader.seek(io::SeekFrom::End(0))?;
+        let max_size = Version::iter().map(|v| v.size()).max().unwrap() as u64;
+        let tail_size = len.min(max_size);
+        reader.seek(io::SeekFrom::Start(len - tail_size))?;
+        let tail = reader.read_len(tail_size as usize)?;
         for ver in Version::iter() {
-            match Pak::read(&mut reader, ver, key.clone()) {
+            let footer_size = ver.size() as u64;
+            if footer_size > tail_size {
+                continue;
+            }
+            let footer = &tail[(tail_size - footer_size) as usize..];
+            let mut magic_offset = 0;
+            if ver.version_major() >= VersionMajor::EncryptionKeyGuid {
+                magic_offset += 16;
+            }
+            if ver.version_major() >= VersionMajor::IndexEncryption {
+                magic_offset += 1;
+            }
+            if footer.get(magic_offset..magic_offset + 4) != Some(&super::MAGIC.to_le_bytes()[..]) {
+                continue;
+            }
+            // full footer check (version field, etc.) before touching the index
+            if super::footer::Footer::read(&mut io::Cursor::new(footer), ver).is_err() {
+                continue;
+            }
+            match Pak::read(&mut reader, ver, key.clone(), lazy) {
                 Ok(pak) => {
                     return Ok(PakReader { pak, key });
                 }
@@ -102,19 +501,48 @@ impl PakReader {
         &self.pak.mount_point
     }
 
+    /// Seed of the pak's path hash index, present for V10+.
+    pub fn path_hash_seed(&self) -> Option<u64> {
+        self.pak.index.path_hash_seed
+    }
+
+    /// Resolves lookups case-insensitively, matching how the engine mounts
+    /// paks: by fnv64 of the lowercased path (V10/V11 semantics — the V10
+    /// pre-bugfix hashes in the file are already recomputed on open). Paks
+    /// without a hash index get one built at the same `u64` per entry cost;
+    /// no lowercased copies of the paths are kept. Affects path lookups
+    /// ([`PakReader::get`], [`PakReader::read_file`], ...), not the paths
+    /// reported by [`PakReader::files`] or prefix queries.
+    pub fn set_case_insensitive(&mut self, enabled: bool) {
+        self.pak.index.set_case_insensitive(enabled);
+    }
+
     pub fn get<R: Read + Seek>(&self, path: &str, reader: &mut R) -> Result<Vec<u8>, super::Error> {
         let mut data = Vec::new();
         self.read_file(path, reader, &mut data)?;
         Ok(data)
     }
 
+    /// Like [`PakReader::get`], but decompresses into a caller-owned buffer
+    /// (cleared first), so long-running callers reading many entries reuse
+    /// one allocation instead of dropping a fresh `Vec` per file.
+    pub fn get_into<R: Read + Seek>(
+        &self,
+        path: &str,
+        reader: &mut R,
+        data: &mut Vec<u8>,
+    ) -> Result<(), super::Error> {
+        data.clear();
+        self.read_file(path, reader, data)
+    }
+
     pub fn read_file<R: Read + Seek, W: Write>(
         &self,
         path: &str,
         reader: &mut R,
         writer: &mut W,
     ) -> Result<(), super::Error> {
-        match self.pak.index.entries().get(path) {
+        match self.pak.index.entry(path)? {
             Some(entry) => entry.read_file(
                 reader,
                 self.pak.version,
@@ -126,8 +554,446 @@ impl PakReader {
         }
     }
 
+    /// Like [`PakReader::read_file`], but reads through a shared positional
+    /// reader (e.g. one `File` used from many threads, see
+    /// [`super::ext::ReadAt`]) without seeking or re-reading the data-region
+    /// entry header.
+    pub fn read_file_at<W: Write>(
+        &self,
+        path: &str,
+        reader: &impl super::ext::ReadAt,
+        writer: &mut W,
+    ) -> Result<(), super::Error> {
+        match self.pak.index.entry(path)? {
+            Some(entry) => entry.read_file_at(
+                reader,
+                self.pak.version,
+                &self.pak.compression,
+                self.key.as_ref(),
+                writer,
+            ),
+            None => Err(super::Error::MissingEntry(path.to_owned())),
+        }
+    }
+
+    /// Checks the footer's index hash and the path hash / full directory
+    /// index hashes against the bytes on disk. The hashes cover the
+    /// (padded) plaintext, so encrypted indexes need the key to verify.
+    pub fn verify_index<R: Read + Seek>(&self, reader: &mut R) -> Result<(), super::Error> {
+        let version = self.pak.version;
+        reader.seek(io::SeekFrom::End(-version.size()))?;
+        let footer = super::footer::Footer::read(reader, version)?;
+        reader.seek(io::SeekFrom::Start(footer.index_offset))?;
+        let mut index = reader.read_len(footer.index_size as usize)?;
+        if footer.encrypted {
+            decrypt(&self.key, &mut index)?;
+        }
+        check_hash("index", footer.hash, &index)?;
+        if version.version_major() >= VersionMajor::PathHashIndex {
+            let mut index = io::Cursor::new(index);
+            index.read_string()?; // mount point
+            index.read_u32::<LE>()?; // entry count
+            index.read_u64::<LE>()?; // path hash seed
+            for context in ["path hash index", "full directory index"] {
+                if index.read_u32::<LE>()? != 0 {
+                    let offset = index.read_u64::<LE>()?;
+                    let size = index.read_u64::<LE>()?;
+                    let hash = index.read_guid()?;
+                    reader.seek(io::SeekFrom::Start(offset))?;
+                    let mut buf = reader.read_len(size as usize)?;
+                    if footer.encrypted {
+                        decrypt(&self.key, &mut buf)?;
+                    }
+                    check_hash(context, hash, &buf)?;
+                }
+            }
+        }
+        Ok(())
+    }
+
+    /// Checks `path`'s stored bytes against the entry's recorded SHA-1.
+    pub fn verify_entry(
+        &self,
+        path: &str,
+        reader: &impl super::ext::ReadAt,
+    ) -> Result<(), super::Error> {
+        match self.pak.index.entry(path)? {
+            Some(entry) => entry.verify(reader, self.pak.version, path),
+            None => Err(super::Error::MissingEntry(path.to_owned())),
+        }
+    }
+
+    /// The recorded SHA-1 of an entry's stored bytes, read from the index
+    /// when present or from the data-region copy of the entry header
+    /// otherwise (V10+ index entries don't record it). Lets two paks be
+    /// compared entry-by-entry without decompressing anything; note the hash
+    /// covers the bytes as written, so it only matches across paks built
+    /// with the same compression and encryption settings.
+    pub fn entry_hash(
+        &self,
+        path: &str,
+        reader: &impl super::ext::ReadAt,
+    ) -> Result<[u8; 20], super::Error> {
+        match self.pak.index.entry(path)? {
+            Some(entry) => entry.stored_hash(reader, self.pak.version),
+            None => Err(super::Error::MissingEntry(path.to_owned())),
+        }
+    }
+
+    /// Paths ordered by data offset, so whole-pak passes (verify, extract)
+    /// read the file forward instead of seeking back and forth.
+    pub fn files_by_offset(&self) -> Result<Vec<String>, super::Error> {
+        let index = &self.pak.index;
+        let mut files = index
+            .paths()
+            .iter()
+            .enumerate()
+            .map(|(slot, path)| Ok((index.entry_at(slot)?.offset, path.clone())))
+            .collect::<Result<Vec<_>, super::Error>>()?;
+        files.sort_by_key(|(offset, _)| *offset);
+        Ok(files.into_iter().map(|(_, path)| path).collect())
+    }
+
+    /// Plans extraction of `paths`: sorts them by data offset and coalesces
+    /// entries adjacent on disk into batches, so a whole-pak pass issues a
+    /// few large sequential reads instead of one seek per entry. A batch
+    /// grows until it would exceed `max_batch_size` bytes or the gap to the
+    /// next entry exceeds `max_gap`; a single entry larger than
+    /// `max_batch_size` still gets its own batch, marked oversized so
+    /// readers stream it instead of buffering its whole span.
+    pub fn plan_extraction(
+        &self,
+        paths: impl IntoIterator<Item = String>,
+        max_batch_size: u64,
+        max_gap: u64,
+    ) -> Result<Vec<ExtractionBatch>, super::Error> {
+        let index = &self.pak.index;
+        let mut spans = paths
+            .into_iter()
+            .map(|path| {
+                let entry = match index.entry(&path)? {
+                    Some(entry) => entry,
+                    None => return Err(super::Error::MissingEntry(path)),
+                };
+                // encrypted entries are stored padded to the AES block size
+                let stored = match entry.is_encrypted() {
+                    true => (entry.compressed + 15) & !15,
+                    false => entry.compressed,
+                };
+                let end = entry.data_offset(self.pak.version) + stored;
+                Ok((entry.offset, end, path))
+            })
+            .collect::<Result<Vec<_>, super::Error>>()?;
+        spans.sort_by_key(|&(start, ..)| start);
+
+        let mut batches: Vec<ExtractionBatch> = vec![];
+        for (start, end, path) in spans {
+            match batches.last_mut() {
+                Some(batch)
+                    if start.saturating_sub(batch.offset + batch.size) <= max_gap
+                        && end - batch.offset <= max_batch_size =>
+                {
+                    batch.size = end - batch.offset;
+                    batch.paths.push(path);
+                }
+                _ => batches.push(ExtractionBatch {
+                    offset: start,
+                    size: end - start,
+                    paths: vec![path],
+                    oversized: end - start > max_batch_size,
+                }),
+            }
+        }
+        Ok(batches)
+    }
+
+    /// Reads a batch's span once through `reader` and decodes each of its
+    /// entries from the in-memory buffer; `open` supplies the writer for
+    /// each path. Oversized batches skip the buffer and stream their entry
+    /// block by block, so peak memory stays around one compression block no
+    /// matter how large the entry is.
+    pub fn read_batch<W: Write>(
+        &self,
+        batch: &ExtractionBatch,
+        reader: &impl super::ext::ReadAt,
+        mut open: impl FnMut(&str) -> Result<W, super::Error>,
+    ) -> Result<(), super::Error> {
+        if batch.oversized {
+            for path in &batch.paths {
+                self.read_file_at(path, reader, &mut open(path)?)?;
+            }
+            return Ok(());
+        }
+        let mut buf = super::pool::scratch();
+        buf.resize(batch.size as usize, 0);
+        let timer = super::stats::timer();
+        reader.read_exact_at(&mut buf, batch.offset)?;
+        timer.stop(super::stats::Phase::Read, batch.size);
+        let window = super::ext::OffsetReadAt {
+            data: &buf,
+            base: batch.offset,
+        };
+        for path in &batch.paths {
+            match self.pak.index.entry(path)? {
+                Some(entry) => entry.read_file_window(
+                    &window,
+                    self.pak.version,
+                    &self.pak.compression,
+                    self.key.as_ref(),
+                    &mut open(path)?,
+                )?,
+                None => return Err(super::Error::MissingEntry(path.clone())),
+            }
+        }
+        Ok(())
+    }
+
+    /// Streams many files to a single consumer in data-offset order, with
+    /// the same coalesced I/O as [`PakReader::read_files`] but no
+    /// per-file writers: each entry is decoded into a reused buffer and
+    /// handed to `sink` in turn. Built for single-stream sinks — a tar or
+    /// zip archive, a socket — where creating one filesystem file per entry
+    /// is the bottleneck rather than the data movement.
+    pub fn read_files_ordered(
+        &self,
+        paths: impl IntoIterator<Item = String>,
+        reader: &impl super::ext::ReadAt,
+        mut sink: impl FnMut(&str, &[u8]) -> Result<(), super::Error>,
+    ) -> Result<(), super::Error> {
+        let mut data = super::pool::scratch();
+        for batch in self.plan_extraction(paths, 8 << 20, 64 << 10)? {
+            // an oversized batch is one entry; stream it off disk block by
+            // block rather than buffering its whole compressed span
+            if batch.oversized {
+                for path in &batch.paths {
+                    data.clear();
+                    self.read_file_at(path, reader, &mut *data)?;
+                    sink(path, &data)?;
+                }
+                continue;
+            }
+            let mut buf = super::pool::scratch();
+            buf.resize(batch.size as usize, 0);
+            let timer = super::stats::timer();
+            reader.read_exact_at(&mut buf, batch.offset)?;
+            timer.stop(super::stats::Phase::Read, batch.size);
+            let window = super::ext::OffsetReadAt {
+                data: &buf,
+                base: batch.offset,
+            };
+            for path in &batch.paths {
+                match self.pak.index.entry(path)? {
+                    Some(entry) => {
+                        data.clear();
+                        entry.read_file_window(
+                            &window,
+                            self.pak.version,
+                            &self.pak.compression,
+                            self.key.as_ref(),
+                            &mut *data,
+                        )?;
+                        sink(path, &data)?;
+                    }
+                    None => return Err(super::Error::MissingEntry(path.clone())),
+                }
+            }
+        }
+        Ok(())
+    }
+
+    /// Reads many files with coalesced I/O: plans batches with
+    /// [`PakReader::plan_extraction`] (8 MiB batches, 64 KiB gap tolerance),
+    /// reads each batch's span with one positional read and fans the
+    /// decodes out across scoped threads. `open` supplies the writer for
+    /// each path. A 200-file asset group load collapses into a handful of
+    /// large sequential reads instead of a seek+read per entry.
+    pub fn read_files<W: Write + Send>(
+        &self,
+        paths: impl IntoIterator<Item = String>,
+        reader: &impl super::ext::ReadAt,
+        mut open: impl FnMut(&str) -> Result<W, super::Error>,
+    ) -> Result<(), super::Error> {
+        let threads = std::thread::available_parallelism().map_or(1, usize::from);
+        for batch in self.plan_extraction(paths, 8 << 20, 64 << 10)? {
+            // an oversized batch is one entry; stream it off disk block by
+            // block rather than buffering its whole compressed span
+            if batch.oversized {
+                for path in &batch.paths {
+                    self.read_file_at(path, reader, &mut open(path)?)?;
+                }
+                continue;
+            }
+            let mut buf = super::pool::scratch();
+            buf.resize(batch.size as usize, 0);
+            let timer = super::stats::timer();
+            reader.read_exact_at(&mut buf, batch.offset)?;
+            timer.stop(super::stats::Phase::Read, batch.size);
+            let window = super::ext::OffsetReadAt {
+                data: &buf,
+                base: batch.offset,
+            };
+            let mut jobs = batch
+                .paths
+                .iter()
+                .map(|path| match self.pak.index.entry(path)? {
+                    Some(entry) => Ok((entry, open(path)?)),
+                    None => Err(super::Error::MissingEntry(path.clone())),
+                })
+                .collect::<Result<Vec<_>, super::Error>>()?;
+            let chunk = jobs.len().div_ceil(threads);
+            std::thread::scope(|scope| {
+                jobs.chunks_mut(chunk.max(1))
+                    .map(|jobs| {
+                        scope.spawn(|| {
+                            for (entry, writer) in jobs {
+                                entry.read_file_window(
+                                    &window,
+                                    self.pak.version,
+                                    &self.pak.compression,
+                                    self.key.as_ref(),
+                                    writer,
+                                )?;
+                            }
+                            Ok::<_, super::Error>(())
+                        })
+                    })
+                    .collect::<Vec<_>>()
+                    .into_iter()
+                    .try_for_each(|handle| handle.join().expect("decode thread panicked"))
+            })?;
+        }
+        Ok(())
+    }
+
+    /// Fetches `path`'s stored bytes with one positional read through an
+    /// asynchronous source, leaving the CPU-heavy part (decrypt,
+    /// decompress) to [`FetchedEntry::decode`]. The returned future does
+    /// nothing but await the read, so hundreds of fetches can be in flight
+    /// concurrently on a small executor while decodes run on a compute
+    /// pool.
+    pub async fn fetch_file(
+        &self,
+        path: &str,
+        reader: &impl super::ext::AsyncReadAt,
+    ) -> Result<FetchedEntry<'_>, super::Error> {
+        let entry = match self.pak.index.entry(path)? {
+            Some(entry) => entry,
+            None => return Err(super::Error::MissingEntry(path.to_owned())),
+        };
+        // encrypted entries are stored padded to the AES block size
+        let stored = match entry.is_encrypted() {
+            true => (entry.compressed + 15) & !15,
+            false => entry.compressed,
+        };
+        let end = entry.data_offset(self.pak.version) + stored;
+        let mut data = vec![0; (end - entry.offset) as usize];
+        let timer = super::stats::timer();
+        reader.read_exact_at_async(&mut data, entry.offset).await?;
+        timer.stop(super::stats::Phase::Read, data.len() as u64);
+        Ok(FetchedEntry {
+            reader: self,
+            entry,
+            data,
+        })
+    }
+
+    /// Like [`PakReader::read_file`], but over an asynchronous source.
+    /// Fetch and decode run back to back; prefer [`PakReader::fetch_file`]
+    /// when decodes should land on a separate compute pool.
+    pub async fn read_file_async<W: Write>(
+        &self,
+        path: &str,
+        reader: &impl super::ext::AsyncReadAt,
+        writer: &mut W,
+    ) -> Result<(), super::Error> {
+        self.fetch_file(path, reader).await?.decode(writer)
+    }
+
+    /// Like [`PakReader::get`], but over an asynchronous source.
+    pub async fn get_async(
+        &self,
+        path: &str,
+        reader: &impl super::ext::AsyncReadAt,
+    ) -> Result<Vec<u8>, super::Error> {
+        let mut data = Vec::new();
+        self.read_file_async(path, reader, &mut data).await?;
+        Ok(data)
+    }
+
+    /// Reads an entry's stored bytes verbatim — no decompression — as a
+    /// [`PartialEntry`] that [`PakWriter::write_partial_entry`] can append
+    /// with a translated block table, so repacks (version bumps, merges)
+    /// move unchanged entries at disk bandwidth. Encrypted entries are
+    /// decrypted (the key is required) and land unencrypted.
+    pub fn read_raw<R: Read + Seek>(
+        &self,
+        path: &str,
+        reader: &mut R,
+    ) -> Result<PartialEntry, super::Error> {
+        match self.pak.index.entry(path)? {
+            Some(entry) => {
+                let data = entry.read_raw(reader, self.pak.version, self.key.as_ref())?;
+                let hash = hash(&data);
+                Ok(PartialEntry {
+                    uncompressed: entry.uncompressed,
+                    compression: entry
+                        .compression
+                        .map(|c| self.pak.compression[c as usize]),
+                    block_sizes: entry
+                        .blocks
+                        .as_ref()
+                        .map_or(vec![], |blocks| blocks.iter().map(|b| b.end - b.start).collect()),
+                    compression_block_size: entry.compression_block_size,
+                    hash,
+                    data,
+                    encrypted: false,
+                })
+            }
+            None => Err(super::Error::MissingEntry(path.to_owned())),
+        }
+    }
+
     pub fn files(&self) -> Vec<String> {
-        self.pak.index.entries().keys().cloned().collect()
+        self.pak.index.paths().to_vec()
+    }
+
+    /// Iterates over the index in sorted path order, borrowing each path and
+    /// its [`Entry`] metadata (sizes, compression, offset) instead of cloning
+    /// like [`PakReader::files`]. Items are `Result` because lazily opened
+    /// paks ([`PakReader::new_any_lazy`]) decode entries on first access;
+    /// they are `Send`, so the iterator can feed rayon via `par_bridge`.
+    pub fn entries(
+        &self,
+    ) -> impl Iterator<Item = Result<(&str, &super::entry::Entry), super::Error>> {
+        self.pak.index.iter()
+    }
+
+    /// Entries whose path is `prefix` or sits under it as a directory
+    /// ("dir/sub" matches "dir/sub/a.txt" but not "dir/subx.txt"). The
+    /// prefix resolves to a contiguous range of the sorted index, so this
+    /// is O(log n + matches) rather than a scan over every entry.
+    pub fn entries_with_prefix<'r>(
+        &'r self,
+        prefix: &str,
+    ) -> impl Iterator<Item = Result<(&'r str, &'r super::entry::Entry), super::Error>> + 'r {
+        let index = &self.pak.index;
+        index
+            .prefix_slots(prefix)
+            .map(move |slot| Ok((index.paths()[slot].as_str(), index.entry_at(slot)?)))
+    }
+
+    /// Entry metadata for `path`, if present.
+    pub fn entry(&self, path: &str) -> Result<Option<&super::entry::Entry>, super::Error> {
+        self.pak.index.entry(path)
+    }
+
+    /// Number of entries in the pak.
+    pub fn len(&self) -> usize {
+        self.pak.index.paths().len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
     }
 
     pub fn into_pakwriter<W: Write + Seek>(
@@ -139,6 +1005,11 @@ impl PakReader {
             pak: self.pak,
             key: self.key,
             writer,
+            compression: None,
+            encrypt_data: false,
+            encrypt_index: false,
+            dedup: None,
+            data_alignment: None,
         })
     }
 }
@@ -151,54 +1022,384 @@ impl<W: Write + Seek> PakWriter<W> {
         mount_point: String,
         path_hash_seed: Option<u64>,
     ) -> Self {
+        let mut pak = Pak::new(version, mount_point, path_hash_seed);
+        if version < Version::V8A {
+            // pre-V8 paks don't name their compression methods in the footer;
+            // the reader assumes this fixed list
+            pak.compression = vec![
+                super::Compression::Zlib,
+                super::Compression::Gzip,
+                super::Compression::Oodle,
+            ];
+        }
         PakWriter {
-            pak: Pak::new(version, mount_point, path_hash_seed),
+            pak,
             writer,
             key,
+            compression: None,
+            encrypt_data: false,
+            encrypt_index: false,
+            dedup: None,
+            data_alignment: None,
+        }
+    }
+
+    /// Deduplicates subsequently written files by content: a file whose
+    /// stored bytes hash the same as an earlier one gets an index entry
+    /// pointing at the existing data instead of a second copy.
+    pub fn set_dedup(&mut self, dedup: bool) {
+        match (dedup, &self.dedup) {
+            (true, None) => self.dedup = Some(HashMap::new()),
+            (false, _) => self.dedup = None,
+            _ => {}
         }
     }
 
+    /// Encrypts entry data written from here on. Requires a key.
+    pub fn set_encrypt_data(&mut self, encrypt: bool) -> Result<(), super::Error> {
+        if encrypt && self.key.is_none() {
+            return Err(super::Error::Encrypted);
+        }
+        self.encrypt_data = encrypt;
+        Ok(())
+    }
+
+    /// Encrypts the index when it is written. Requires a key.
+    pub fn set_encrypt_index(&mut self, encrypt: bool) -> Result<(), super::Error> {
+        if encrypt && self.key.is_none() {
+            return Err(super::Error::Encrypted);
+        }
+        self.encrypt_index = encrypt;
+        Ok(())
+    }
+
+    /// Aligns the data payload of subsequently written entries to
+    /// `alignment` bytes (e.g. the page size for mmap-friendly bulk data),
+    /// padding the data region with zeros before each write. `None` packs
+    /// entries back to back as before. Must be a power of two;
+    /// [`PakWriter::write_file_aligned`] overrides it per file.
+    pub fn set_data_alignment(&mut self, alignment: Option<u64>) -> Result<(), super::Error> {
+        if let Some(alignment) = alignment {
+            if !alignment.is_power_of_two() {
+                return Err(super::Error::Other(format!(
+                    "alignment {alignment} is not a power of two"
+                )));
+            }
+        }
+        self.data_alignment = alignment;
+        Ok(())
+    }
+
+    /// Sets the compression method applied by [`PakWriter::write_file`] to
+    /// subsequently written files.
+    pub fn set_compression(
+        &mut self,
+        compression: Option<super::Compression>,
+    ) -> Result<(), super::Error> {
+        if compression.is_some()
+            && self.pak.version.version_major() < VersionMajor::CompressionEncryption
+        {
+            return Err(super::Error::Version {
+                used: VersionMajor::CompressionEncryption,
+                version: self.pak.version.version_major(),
+            });
+        }
+        self.compression = compression;
+        Ok(())
+    }
+
+    /// Index of `compression` in the pak's method list, registering it if
+    /// there is a free footer slot.
+    fn compression_index(&mut self, compression: super::Compression) -> Result<u32, super::Error> {
+        if let Some(i) = self.pak.compression.iter().position(|&c| c == compression) {
+            return Ok(i as u32);
+        }
+        let slots = match self.pak.version {
+            ver if ver < Version::V8A => 0, // fixed list set up in new()
+            ver if ver < Version::V8B => 4,
+            _ => 5,
+        };
+        if self.pak.compression.len() >= slots {
+            return Err(super::Error::WriteCompression(compression));
+        }
+        self.pak.compression.push(compression);
+        Ok(self.pak.compression.len() as u32 - 1)
+    }
+
     pub fn into_writer(self) -> W {
         self.writer
     }
 
     pub fn write_file<R: Read>(&mut self, path: &str, reader: &mut R) -> Result<(), super::Error> {
+        self.write_file_aligned(path, reader, self.data_alignment)
+    }
+
+    /// Like [`PakWriter::write_file`], but overrides the writer's data
+    /// alignment for this file (e.g. the page size for one mmap-able asset
+    /// in an otherwise tightly packed pak).
+    pub fn write_file_aligned<R: Read>(
+        &mut self,
+        path: &str,
+        reader: &mut R,
+        alignment: Option<u64>,
+    ) -> Result<(), super::Error> {
         let mut data = vec![];
         reader.read_to_end(&mut data)?;
+        let partial = match self.compression {
+            Some(compression) => PartialEntry::compressed(data, compression)?,
+            None => PartialEntry::new(data),
+        };
+        self.write_partial_entry_aligned(path, partial, alignment)
+    }
 
-        use sha1::{Digest, Sha1};
-        let mut hasher = Sha1::new();
-        hasher.update(&data);
-
+    /// Pads the data region with zeros so the payload of an entry whose
+    /// header is `header_size` bytes starts at a multiple of `alignment`,
+    /// and returns the entry's (header) offset.
+    fn align_payload(
+        &mut self,
+        header_size: u64,
+        alignment: Option<u64>,
+    ) -> Result<u64, super::Error> {
         let offset = self.writer.stream_position()?;
-        let len = data.len() as u64;
+        let Some(alignment) = alignment else {
+            return Ok(offset);
+        };
+        if !alignment.is_power_of_two() {
+            return Err(super::Error::Other(format!(
+                "alignment {alignment} is not a power of two"
+            )));
+        }
+        let pad = (offset + header_size).wrapping_neg() & (alignment - 1);
+        if pad > 0 {
+            self.writer.write_all(&vec![0; pad as usize])?;
+        }
+        Ok(offset + pad)
+    }
 
-        let entry = super::entry::Entry {
+    /// Like [`PakWriter::write_file`], but copies the input in fixed-size
+    /// chunks instead of buffering it, feeding the hash incrementally and
+    /// back-patching the entry header once the length and hash are known.
+    /// Peak memory is one chunk rather than the whole file; the entry is
+    /// stored uncompressed regardless of [`PakWriter::set_compression`],
+    /// which suits the large bulk files this is meant for.
+    /// [`PakWriter::set_encrypt_data`] is honored: chunks are encrypted as
+    /// they stream through, producing the same bytes as the buffered path.
+    pub fn write_file_streaming<R: Read>(
+        &mut self,
+        path: &str,
+        reader: &mut R,
+    ) -> Result<(), super::Error> {
+        use sha1::{Digest, Sha1};
+        let encrypt = self.encrypt_data;
+        if encrypt && self.key.is_none() {
+            return Err(super::Error::Encrypted);
+        }
+        let header_size = super::entry::Entry::get_serialized_size(self.pak.version, None, 0);
+        let offset = self.align_payload(header_size, self.data_alignment)?;
+
+        // placeholder header; its serialized size doesn't depend on the
+        // length or hash, so the patched header lands exactly over it
+        let mut entry = super::entry::Entry {
             offset,
-            compressed: len,
-            uncompressed: len,
+            compressed: 0,
+            uncompressed: 0,
             compression: None,
             timestamp: None,
-            hash: Some(hasher.finalize().into()),
+            hash: Some([0; 20]),
             blocks: None,
             flags: 0,
             compression_block_size: 0,
         };
+        entry.write(
+            &mut self.writer,
+            self.pak.version,
+            super::entry::EntryLocation::Data,
+        )?;
 
+        let mut hasher = Sha1::new();
+        let mut len: u64 = 0;
+        let mut buf = vec![0; 0x10000];
+        match encrypt {
+            false => loop {
+                let read = reader.read(&mut buf)?;
+                if read == 0 {
+                    break;
+                }
+                hasher.update(&buf[..read]);
+                self.writer.write_all(&buf[..read])?;
+                len += read as u64;
+            },
+            true => {
+                let key = self.key.clone().expect("checked above");
+                // whole AES blocks are encrypted and flushed as they fill;
+                // the partial block (and the entry's first bytes, which seed
+                // the trailing padding) carry over between reads
+                let mut fill = 0;
+                let mut first = Vec::with_capacity(16);
+                loop {
+                    let read = reader.read(&mut buf[fill..])?;
+                    if read == 0 {
+                        break;
+                    }
+                    if first.len() < 16 {
+                        let take = (16 - first.len()).min(read);
+                        first.extend_from_slice(&buf[fill..fill + take]);
+                    }
+                    fill += read;
+                    len += read as u64;
+                    let whole = fill & !15;
+                    if whole > 0 {
+                        super::crypto::encrypt(&key, &mut buf[..whole]);
+                        hasher.update(&buf[..whole]);
+                        self.writer.write_all(&buf[..whole])?;
+                        buf.copy_within(whole..fill, 0);
+                        fill -= whole;
+                    }
+                }
+                if fill > 0 {
+                    // pad the trailing block by repeating the entry's first
+                    // bytes, matching the buffered path (and UnrealPak); the
+                    // recorded hash covers only the unpadded ciphertext
+                    for pad in 0..16 - fill {
+                        buf[fill + pad] = first[pad % first.len()];
+                    }
+                    super::crypto::encrypt(&key, &mut buf[..16]);
+                    hasher.update(&buf[..fill]);
+                    self.writer.write_all(&buf[..16])?;
+                }
+            }
+        }
+
+        entry.compressed = len;
+        entry.uncompressed = len;
+        entry.hash = Some(hasher.finalize().into());
+        entry.flags = encrypt as u8;
+
+        let end = self.writer.stream_position()?;
+        self.writer.seek(io::SeekFrom::Start(offset))?;
         entry.write(
             &mut self.writer,
             self.pak.version,
             super::entry::EntryLocation::Data,
         )?;
+        self.writer.seek(io::SeekFrom::Start(end))?;
 
         self.pak.index.add_entry(path, entry);
+        Ok(())
+    }
+
+    /// Commits an entry prepared by [`PartialEntry::new`] or
+    /// [`PartialEntry::compressed`], e.g. on a worker thread, at the writer's
+    /// current position.
+    pub fn write_partial_entry(
+        &mut self,
+        path: &str,
+        partial: PartialEntry,
+    ) -> Result<(), super::Error> {
+        self.write_partial_entry_aligned(path, partial, self.data_alignment)
+    }
+
+    /// Like [`PakWriter::write_partial_entry`], but overrides the writer's
+    /// data alignment for this entry.
+    pub fn write_partial_entry_aligned(
+        &mut self,
+        path: &str,
+        mut partial: PartialEntry,
+        alignment: Option<u64>,
+    ) -> Result<(), super::Error> {
+        if self.encrypt_data {
+            match &self.key {
+                Some(key) => partial.encrypt(key),
+                None => return Err(super::Error::Encrypted),
+            }
+        }
+        if let Some(dedup) = &self.dedup {
+            if let Some(existing) = dedup.get(&partial.hash) {
+                // size check guards the (astronomically unlikely) hash
+                // collision; a repeat only gets an index entry
+                if existing.uncompressed == partial.uncompressed {
+                    let existing = existing.clone();
+                    self.pak.index.add_entry(path, existing);
+                    return Ok(());
+                }
+            }
+        }
+        let compression = match partial.compression {
+            Some(compression) => Some(self.compression_index(compression)?),
+            None => None,
+        };
+
+        let header_size = super::entry::Entry::get_serialized_size(
+            self.pak.version,
+            compression,
+            partial.block_sizes.len() as u32,
+        );
+        let offset = self.align_payload(header_size, alignment)?;
+
+        let blocks = partial.compression.is_some().then(|| {
+            // block offsets are relative to the entry (including its
+            // data-region header) for V5+, absolute before that
+            let mut start = header_size
+                + match self.pak.version.version_major() >= VersionMajor::RelativeChunkOffsets {
+                    true => 0,
+                    false => offset,
+                };
+            partial
+                .block_sizes
+                .iter()
+                .map(|size| {
+                    let block = super::entry::Block {
+                        start,
+                        end: start + size,
+                    };
+                    // encrypted blocks sit at padded boundaries on disk
+                    start += match partial.encrypted {
+                        true => (size + 15) & !15,
+                        false => *size,
+                    };
+                    block
+                })
+                .collect()
+        });
 
-        self.writer.write_all(&data)?;
+        let entry = super::entry::Entry {
+            offset,
+            // the recorded size of encrypted uncompressed entries excludes
+            // the padding (which is still written)
+            compressed: match (partial.encrypted, partial.compression) {
+                (true, None) => partial.uncompressed,
+                _ => partial.data.len() as u64,
+            },
+            uncompressed: partial.uncompressed,
+            compression,
+            timestamp: None,
+            hash: Some(partial.hash),
+            blocks,
+            flags: partial.encrypted as u8,
+            compression_block_size: partial.compression_block_size,
+        };
+
+        entry.write(
+            &mut self.writer,
+            self.pak.version,
+            super::entry::EntryLocation::Data,
+        )?;
+
+        if let Some(dedup) = &mut self.dedup {
+            dedup.entry(partial.hash).or_insert_with(|| entry.clone());
+        }
+        self.pak.index.add_entry(path, entry);
+
+        let timer = super::stats::timer();
+        self.writer.write_all(&partial.data)?;
+        timer.stop(super::stats::Phase::Write, partial.data.len() as u64);
         Ok(())
     }
 
     pub fn write_index(mut self) -> Result<W, super::Error> {
-        self.pak.write(&mut self.writer, self.key)?;
+        self.pak.index.commit_pending();
+        self.pak
+            .write(&mut self.writer, self.key.as_ref(), self.encrypt_index)?;
         Ok(self.writer)
     }
 }
@@ -208,6 +1409,7 @@ impl Pak {
         mut reader: R,
         version: super::Version,
         key: Option<aes::Aes256>,
+        lazy: bool,
     ) -> Result<Self, super::Error> {
         // read footer to get index, encryption & compression info
         reader.seek(io::SeekFrom::End(-version.size()))?;
@@ -228,8 +1430,7 @@ impl Pak {
         let index = if version.version_major() >= VersionMajor::PathHashIndex {
             let path_hash_seed = index.read_u64::<LE>()?;
 
-            // Left in for potential desire to verify path index hashes.
-            let _path_hash_index = if index.read_u32::<LE>()? != 0 {
+            let path_hash_index = if index.read_u32::<LE>()? != 0 {
                 let path_hash_index_offset = index.read_u64::<LE>()?;
                 let path_hash_index_size = index.read_u64::<LE>()?;
                 let _path_hash_index_hash = index.read_len(20)?;
@@ -290,41 +1491,97 @@ impl Pak {
             let size = index.read_u32::<LE>()? as usize;
             let encoded_entries = index.read_len(size)?;
 
-            let mut entries_by_path = BTreeMap::new();
+            let mut listed = Vec::new();
             if let Some(fdi) = &full_directory_index {
-                let mut encoded_entries = io::Cursor::new(&encoded_entries);
                 for (dir_name, dir) in fdi {
                     for (file_name, encoded_offset) in dir {
-                        encoded_entries.seek(io::SeekFrom::Start(*encoded_offset as u64))?;
-                        let entry =
-                            super::entry::Entry::read_encoded(&mut encoded_entries, version)?;
                         let path = format!(
                             "{}{}",
                             dir_name.strip_prefix('/').unwrap_or(dir_name),
                             file_name
                         );
-                        entries_by_path.insert(path, entry);
+                        listed.push((path, *encoded_offset));
                     }
                 }
             }
+            listed.sort_by(|a, b| a.0.cmp(&b.0));
+
+            let mut slot_by_encoded_offset = HashMap::with_capacity(listed.len());
+            let mut paths = Vec::with_capacity(listed.len());
+            let mut entries = Vec::with_capacity(listed.len());
+            for (slot, (path, encoded_offset)) in listed.into_iter().enumerate() {
+                slot_by_encoded_offset.insert(encoded_offset, slot as u32);
+                paths.push(path);
+                entries.push(EntrySlot {
+                    entry: std::sync::OnceLock::new(),
+                    encoded_offset,
+                });
+            }
+
+            // the pak's path hash index can only be probed when its hash
+            // function matches ours (the post-bugfix fnv64); compute the
+            // hashes ourselves for V10
+            let path_hash_index = match path_hash_index {
+                Some(phi) if version >= Version::V11 => Some(
+                    phi.iter()
+                        .filter_map(|(hash, encoded_offset)| {
+                            slot_by_encoded_offset
+                                .get(encoded_offset)
+                                .map(|slot| (*hash, *slot))
+                        })
+                        .collect::<HashMap<_, _>>(),
+                ),
+                _ => Some(
+                    paths
+                        .iter()
+                        .enumerate()
+                        .map(|(slot, path)| (fnv64_path(path, path_hash_seed), slot as u32))
+                        .collect::<HashMap<_, _>>(),
+                ),
+            };
 
             assert_eq!(index.read_u32::<LE>()?, 0, "remaining index bytes are 0"); // TODO possibly remaining unencoded entries?
 
-            Index {
+            let mut index = Index {
                 path_hash_seed: Some(path_hash_seed),
-                entries: entries_by_path,
+                paths,
+                entries,
+                path_hash_index,
+                encoded_entries: Some(EncodedEntries {
+                    version,
+                    data: encoded_entries,
+                }),
+                case_insensitive: false,
+                pending: vec![],
+            };
+            if !lazy {
+                for slot in 0..index.len() {
+                    index.entry_at(slot)?;
+                }
+                index.encoded_entries = None;
             }
+            index
         } else {
-            let mut entries = BTreeMap::new();
+            let mut decoded = Vec::with_capacity(len);
             for _ in 0..len {
-                entries.insert(
+                decoded.push((
                     index.read_string()?,
                     super::entry::Entry::read(&mut index, version)?,
-                );
+                ));
             }
+            decoded.sort_by(|a, b| a.0.cmp(&b.0));
+            let (paths, entries) = decoded
+                .into_iter()
+                .map(|(path, entry)| (path, EntrySlot::from(entry)))
+                .unzip();
             Index {
                 path_hash_seed: None,
+                paths,
                 entries,
+                path_hash_index: None,
+                encoded_entries: None,
+                case_insensitive: false,
+                pending: vec![],
             }
         };
 
@@ -340,8 +1597,19 @@ impl Pak {
     fn write<W: Write + Seek>(
         &self,
         writer: &mut W,
-        _key: Option<aes::Aes256>,
+        key: Option<&Aes256>,
+        encrypt_index: bool,
     ) -> Result<(), super::Error> {
+        // each index region is padded to the AES block size, encrypted as a
+        // whole, and hashed as stored (the reader checks hashes before
+        // decrypting)
+        let key = match encrypt_index {
+            true => match key {
+                Some(key) => Some(key),
+                None => return Err(super::Error::Encrypted),
+            },
+            false => None,
+        };
         let index_offset = writer.stream_position()?;
 
         let mut index_buf = vec![];
@@ -349,11 +1617,11 @@ impl Pak {
         index_writer.write_string(&self.mount_point)?;
 
         let secondary_index = if self.version < super::Version::V10 {
-            let record_count = self.index.entries.len() as u32;
+            let record_count = self.index.len() as u32;
             index_writer.write_u32::<LE>(record_count)?;
-            for (path, entry) in &self.index.entries {
+            for (slot, path) in self.index.paths.iter().enumerate() {
                 index_writer.write_string(path)?;
-                entry.write(
+                self.index.entry_at(slot)?.write(
                     &mut index_writer,
                     self.version,
                     super::entry::EntryLocation::Index,
@@ -361,17 +1629,17 @@ impl Pak {
             }
             None
         } else {
-            let record_count = self.index.entries.len() as u32;
+            let record_count = self.index.len() as u32;
             let path_hash_seed = self.index.path_hash_seed.unwrap_or_default();
             index_writer.write_u32::<LE>(record_count)?;
             index_writer.write_u64::<LE>(path_hash_seed)?;
 
             let (encoded_entries, offsets) = {
-                let mut offsets = Vec::with_capacity(self.index.entries.len());
+                let mut offsets = Vec::with_capacity(self.index.len());
                 let mut encoded_entries = io::Cursor::new(vec![]);
-                for entry in self.index.entries.values() {
+                for slot in 0..self.index.len() {
                     offsets.push(encoded_entries.get_ref().len() as u32);
-                    entry.write(
+                    self.index.entry_at(slot)?.write(
                         &mut encoded_entries,
                         self.version,
                         super::entry::EntryLocation::Index,
@@ -417,32 +1685,48 @@ impl Pak {
                 size
             };
 
-            let path_hash_index_offset = index_offset + bytes_before_phi;
+            // the index header itself gets padded before encryption, which
+            // pushes the secondary indexes back accordingly
+            let align = |size: u64| match key {
+                Some(_) => (size + 15) & !15,
+                None => size,
+            };
+            let path_hash_index_offset = index_offset + align(bytes_before_phi);
 
+            // the recorded hashes cover the padded plaintext; only then is
+            // each region encrypted in place
             let mut phi_buf = vec![];
             let mut phi_writer = io::Cursor::new(&mut phi_buf);
-            generate_path_hash_index(
-                &mut phi_writer,
-                path_hash_seed,
-                &self.index.entries,
-                &offsets,
-            )?;
+            generate_path_hash_index(&mut phi_writer, path_hash_seed, &self.index.paths, &offsets)?;
+            if key.is_some() {
+                pad_repeat_to_alignment(&mut phi_buf, 16);
+            }
+            let phi_hash = hash(&phi_buf);
 
             let full_directory_index_offset = path_hash_index_offset + phi_buf.len() as u64;
 
             let mut fdi_buf = vec![];
             let mut fdi_writer = io::Cursor::new(&mut fdi_buf);
-            generate_full_directory_index(&mut fdi_writer, &self.index.entries, &offsets)?;
+            generate_full_directory_index(&mut fdi_writer, &self.index.paths, &offsets)?;
+            if key.is_some() {
+                pad_repeat_to_alignment(&mut fdi_buf, 16);
+            }
+            let fdi_hash = hash(&fdi_buf);
+
+            if let Some(key) = key {
+                encrypt(key, &mut phi_buf);
+                encrypt(key, &mut fdi_buf);
+            }
 
             index_writer.write_u32::<LE>(1)?; // we have path hash index
             index_writer.write_u64::<LE>(path_hash_index_offset)?;
             index_writer.write_u64::<LE>(phi_buf.len() as u64)?; // path hash index size
-            index_writer.write_all(&hash(&phi_buf))?;
+            index_writer.write_all(&phi_hash)?;
 
             index_writer.write_u32::<LE>(1)?; // we have full directory index
             index_writer.write_u64::<LE>(full_directory_index_offset)?;
             index_writer.write_u64::<LE>(fdi_buf.len() as u64)?; // path hash index size
-            index_writer.write_all(&hash(&fdi_buf))?;
+            index_writer.write_all(&fdi_hash)?;
 
             index_writer.write_u32::<LE>(encoded_entries.len() as u32)?;
             index_writer.write_all(&encoded_entries)?;
@@ -452,7 +1736,13 @@ impl Pak {
             Some((phi_buf, fdi_buf))
         };
 
+        if key.is_some() {
+            pad_repeat_to_alignment(&mut index_buf, 16);
+        }
         let index_hash = hash(&index_buf);
+        if let Some(key) = key {
+            encrypt(key, &mut index_buf);
+        }
 
         writer.write_all(&index_buf)?;
 
@@ -463,7 +1753,7 @@ impl Pak {
 
         let footer = super::footer::Footer {
             encryption_uuid: None,
-            encrypted: false,
+            encrypted: key.is_some(),
             magic: super::MAGIC,
             version: self.version,
             version_major: self.version.version_major(),
@@ -487,21 +1777,31 @@ fn hash(data: &[u8]) -> [u8; 20] {
     hasher.finalize().into()
 }
 
+pub(crate) fn hex(hash: &[u8]) -> String {
+    hash.iter().map(|b| format!("{b:02x}")).collect()
+}
+
+fn check_hash(context: &str, expected: [u8; 20], data: &[u8]) -> Result<(), super::Error> {
+    let got = hash(data);
+    if got != expected {
+        return Err(super::Error::HashMismatch {
+            context: context.to_owned(),
+            expected: hex(&expected),
+            got: hex(&got),
+        });
+    }
+    Ok(())
+}
+
 fn generate_path_hash_index<W: Write>(
     writer: &mut W,
     path_hash_seed: u64,
-    entries: &BTreeMap<String, super::entry::Entry>,
+    paths: &[String],
     offsets: &Vec<u32>,
 ) -> Result<(), super::Error> {
-    writer.write_u32::<LE>(entries.len() as u32)?;
-    for (path, offset) in entries.keys().zip(offsets) {
-        let utf16le_path = path
-            .to_lowercase()
-            .encode_utf16()
-            .flat_map(|c| c.to_le_bytes())
-            .collect::<Vec<_>>();
-        let path_hash = fnv64(&utf16le_path, path_hash_seed);
-        writer.write_u64::<LE>(path_hash)?;
+    writer.write_u32::<LE>(paths.len() as u32)?;
+    for (path, offset) in paths.iter().zip(offsets) {
+        writer.write_u64::<LE>(fnv64_path(path, path_hash_seed))?;
         writer.write_u32::<LE>(*offset)?;
     }
 
@@ -510,24 +1810,43 @@ fn generate_path_hash_index<W: Write>(
     Ok(())
 }
 
-fn fnv64(data: &[u8], offset: u64) -> u64 {
+fn fnv64(data: impl IntoIterator<Item = u8>, offset: u64) -> u64 {
     const OFFSET: u64 = 0xcbf29ce484222325;
     const PRIME: u64 = 0x00000100000001b3;
     let mut hash = OFFSET.wrapping_add(offset);
-    for &b in data {
+    for b in data {
         hash ^= b as u64;
         hash = hash.wrapping_mul(PRIME);
     }
     hash
 }
 
+/// Case-insensitive path equality under the same lowercasing the path hash
+/// applies, compared character by character so neither side is copied.
+fn eq_path_ignore_case(a: &str, b: &str) -> bool {
+    a.chars()
+        .flat_map(char::to_lowercase)
+        .eq(b.chars().flat_map(char::to_lowercase))
+}
+
+/// Path hash used by the path hash index: fnv64 over the lowercased UTF-16LE
+/// path (post-Fnv64BugFix semantics).
+fn fnv64_path(path: &str, seed: u64) -> u64 {
+    fnv64(
+        path.to_lowercase()
+            .encode_utf16()
+            .flat_map(u16::to_le_bytes),
+        seed,
+    )
+}
+
 fn generate_full_directory_index<W: Write>(
     writer: &mut W,
-    entries: &BTreeMap<String, super::entry::Entry>,
+    paths: &[String],
     offsets: &Vec<u32>,
 ) -> Result<(), super::Error> {
     let mut fdi = BTreeMap::new();
-    for (path, offset) in entries.keys().zip(offsets) {
+    for (path, offset) in paths.iter().zip(offsets) {
         let (directory, filename) = {
             let i = path.rfind('/').map(|i| i + 1); // we want to include the slash on the directory
             match i {
@@ -563,17 +1882,19 @@ fn generate_full_directory_index<W: Write>(
     Ok(())
 }
 
-fn pad_zeros_to_alignment(v: &mut Vec<u8>, alignment: usize) {
+/// UnrealPak pads buffers before encryption by repeating the buffer from its
+/// start rather than with zeros; matching it keeps output byte-identical.
+fn pad_repeat_to_alignment(v: &mut Vec<u8>, alignment: usize) {
     assert!(alignment >= 1);
-    if v.len() % alignment != 0 {
-        v.extend(std::iter::repeat(0).take(((v.len() + alignment - 1) / alignment) * alignment))
+    let len = v.len();
+    if len == 0 {
+        return;
+    }
+    for i in len..((len + alignment - 1) / alignment) * alignment {
+        v.push(v[i % len]);
     }
-    assert!(v.len() % alignment == 0);
 }
 
-fn encrypt(key: Aes256, bytes: &mut [u8]) {
-    use aes::cipher::BlockEncrypt;
-    for chunk in bytes.chunks_mut(16) {
-        key.encrypt_block(aes::Block::from_mut_slice(chunk))
-    }
+fn encrypt(key: &Aes256, bytes: &mut [u8]) {
+    super::crypto::encrypt(key, bytes)
 }
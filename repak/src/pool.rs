@@ -0,0 +1,53 @@
+//! Thread-local reuse of the scratch buffers the read paths burn through
+//! (per-block compressed data, decompressed output, batch windows). Fresh
+//! allocations per entry add up to allocator churn in the tens of GB over a
+//! big unpack and show up as malloc contention once enough threads pile on;
+//! a thread-local stack avoids both the churn and any cross-thread locking.
+
+use std::cell::RefCell;
+
+thread_local! {
+    static POOL: RefCell<Vec<Vec<u8>>> = const { RefCell::new(Vec::new()) };
+}
+
+/// Per-thread pool bounds: enough slots for the buffers live at once in one
+/// decode (block scratch + decompressed output + batch window), without
+/// letting one huge entry pin its buffer on every worker thread forever.
+const MAX_POOLED: usize = 4;
+const MAX_POOLED_CAPACITY: usize = 32 << 20;
+
+/// A `Vec<u8>` borrowed from the pool; handed out empty and returned on
+/// drop. Derefs to the vector, so it goes anywhere a `&mut Vec<u8>` does.
+pub(crate) struct Scratch(Vec<u8>);
+
+pub(crate) fn scratch() -> Scratch {
+    let mut buf = POOL.with_borrow_mut(|pool| pool.pop()).unwrap_or_default();
+    buf.clear();
+    Scratch(buf)
+}
+
+impl Drop for Scratch {
+    fn drop(&mut self) {
+        if self.0.capacity() == 0 || self.0.capacity() > MAX_POOLED_CAPACITY {
+            return;
+        }
+        POOL.with_borrow_mut(|pool| {
+            if pool.len() < MAX_POOLED {
+                pool.push(std::mem::take(&mut self.0));
+            }
+        });
+    }
+}
+
+impl std::ops::Deref for Scratch {
+    type Target = Vec<u8>;
+    fn deref(&self) -> &Vec<u8> {
+        &self.0
+    }
+}
+
+impl std::ops::DerefMut for Scratch {
+    fn deref_mut(&mut self) -> &mut Vec<u8> {
+        &mut self.0
+    }
+}
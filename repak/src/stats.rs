@@ -0,0 +1,178 @@
+//! Opt-in instrumentation of the hot paths: byte counts and accumulated
+//! wall time per phase (read, AES, inflate/deflate, write), collected with
+//! relaxed atomics so enabling it costs two timestamps per recorded span.
+//! Answers "is this run I/O-bound, AES-bound or inflate-bound" without
+//! profiling the box.
+
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering::Relaxed};
+use std::time::Instant;
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// Turns collection on or off. Counters keep their values; combine with
+/// [`reset`] to scope a measurement to one run.
+pub fn set_enabled(enabled: bool) {
+    ENABLED.store(enabled, Relaxed);
+}
+
+struct Counters {
+    bytes: AtomicU64,
+    nanos: AtomicU64,
+}
+
+impl Counters {
+    const fn new() -> Self {
+        Counters {
+            bytes: AtomicU64::new(0),
+            nanos: AtomicU64::new(0),
+        }
+    }
+
+    fn snapshot(&self) -> PhaseStats {
+        PhaseStats {
+            bytes: self.bytes.load(Relaxed),
+            nanos: self.nanos.load(Relaxed),
+        }
+    }
+
+    fn reset(&self) {
+        self.bytes.store(0, Relaxed);
+        self.nanos.store(0, Relaxed);
+    }
+}
+
+/// One [`Counters`] slot per [`super::Compression`] variant.
+const COMPRESSIONS: [super::Compression; 5] = [
+    super::Compression::None,
+    super::Compression::Zlib,
+    super::Compression::Gzip,
+    super::Compression::Oodle,
+    super::Compression::Zstd,
+];
+
+static READ: Counters = Counters::new();
+static DECRYPT: Counters = Counters::new();
+static ENCRYPT: Counters = Counters::new();
+static WRITE: Counters = Counters::new();
+static DECOMPRESS: [Counters; COMPRESSIONS.len()] = [
+    Counters::new(),
+    Counters::new(),
+    Counters::new(),
+    Counters::new(),
+    Counters::new(),
+];
+static COMPRESS: [Counters; COMPRESSIONS.len()] = [
+    Counters::new(),
+    Counters::new(),
+    Counters::new(),
+    Counters::new(),
+    Counters::new(),
+];
+static ENTRY_LOOKUPS: AtomicU64 = AtomicU64::new(0);
+
+#[derive(Debug, Clone, Copy)]
+pub(crate) enum Phase {
+    Read,
+    Decrypt,
+    Encrypt,
+    Write,
+    Decompress(super::Compression),
+    Compress(super::Compression),
+}
+
+impl Phase {
+    fn counters(self) -> &'static Counters {
+        match self {
+            Phase::Read => &READ,
+            Phase::Decrypt => &DECRYPT,
+            Phase::Encrypt => &ENCRYPT,
+            Phase::Write => &WRITE,
+            Phase::Decompress(compression) => &DECOMPRESS[compression as usize],
+            Phase::Compress(compression) => &COMPRESS[compression as usize],
+        }
+    }
+}
+
+/// Started before a span of work; [`Timer::stop`] attributes the elapsed
+/// time and processed bytes to a phase. Free when collection is disabled.
+pub(crate) struct Timer(Option<Instant>);
+
+pub(crate) fn timer() -> Timer {
+    Timer(ENABLED.load(Relaxed).then(Instant::now))
+}
+
+impl Timer {
+    /// A timer that never records, for spans whose cost another phase
+    /// already covers (e.g. copies out of an in-memory batch window).
+    pub(crate) fn off() -> Timer {
+        Timer(None)
+    }
+
+    pub(crate) fn stop(self, phase: Phase, bytes: u64) {
+        let Some(start) = self.0 else { return };
+        let counters = phase.counters();
+        counters.bytes.fetch_add(bytes, Relaxed);
+        counters
+            .nanos
+            .fetch_add(start.elapsed().as_nanos() as u64, Relaxed);
+    }
+}
+
+pub(crate) fn count_entry_lookup() {
+    if ENABLED.load(Relaxed) {
+        ENTRY_LOOKUPS.fetch_add(1, Relaxed);
+    }
+}
+
+/// Bytes processed and wall time accumulated in one phase. Times from
+/// concurrent threads add up, so throughput derived from them is
+/// per-thread, not wall-clock.
+#[derive(Debug, Default, Clone, Copy)]
+pub struct PhaseStats {
+    pub bytes: u64,
+    pub nanos: u64,
+}
+
+/// A point-in-time copy of all counters. The per-compression lists carry
+/// only variants that saw traffic.
+#[derive(Debug, Default, Clone)]
+pub struct Stats {
+    pub entry_lookups: u64,
+    pub read: PhaseStats,
+    pub decrypt: PhaseStats,
+    pub encrypt: PhaseStats,
+    pub write: PhaseStats,
+    pub decompress: Vec<(super::Compression, PhaseStats)>,
+    pub compress: Vec<(super::Compression, PhaseStats)>,
+}
+
+pub fn snapshot() -> Stats {
+    let active = |counters: &'static [Counters]| {
+        COMPRESSIONS
+            .iter()
+            .zip(counters)
+            .map(|(compression, counters)| (*compression, counters.snapshot()))
+            .filter(|(_, stats)| stats.bytes > 0)
+            .collect()
+    };
+    Stats {
+        entry_lookups: ENTRY_LOOKUPS.load(Relaxed),
+        read: READ.snapshot(),
+        decrypt: DECRYPT.snapshot(),
+        encrypt: ENCRYPT.snapshot(),
+        write: WRITE.snapshot(),
+        decompress: active(&DECOMPRESS),
+        compress: active(&COMPRESS),
+    }
+}
+
+pub fn reset() {
+    for counters in [&READ, &DECRYPT, &ENCRYPT, &WRITE]
+        .into_iter()
+        .chain(&DECOMPRESS)
+        .chain(&COMPRESS)
+    {
+        counters.reset();
+    }
+    ENTRY_LOOKUPS.store(0, Relaxed);
+}
@@ -0,0 +1,117 @@
+use std::collections::HashMap;
+use std::io::{Read, Seek, Write};
+
+use super::PakReader;
+
+/// A stack of paks mounted as one virtual filesystem, resolving each path
+/// with a single lookup regardless of layer count.
+///
+/// Paks are given in load order and later paks shadow earlier ones (UE patch
+/// pak convention). The unified index is built once at mount time, so a
+/// lookup is one hash probe into `path -> (pak, entry)` instead of walking
+/// every layer's index on a miss.
+#[derive(Debug)]
+pub struct PakVfs {
+    paks: Vec<PakReader>,
+    /// `path -> (pak index, entry slot in that pak)`
+    lookup: HashMap<String, (usize, usize)>,
+}
+
+impl PakVfs {
+    /// Mounts `paks` in load order. All paks must share a mount point, since
+    /// entry paths only refer to the same files relative to the same root.
+    pub fn new(paks: Vec<PakReader>) -> Result<Self, super::Error> {
+        let Some(first) = paks.first() else {
+            return Err(super::Error::Other("no paks to mount".to_owned()));
+        };
+        let mount_point = first.mount_point();
+        for pak in &paks {
+            if pak.mount_point() != mount_point {
+                return Err(super::Error::Other(format!(
+                    "mount point mismatch: {:?} vs {:?}",
+                    mount_point,
+                    pak.mount_point()
+                )));
+            }
+        }
+
+        let mut lookup = HashMap::new();
+        for (index, pak) in paks.iter().enumerate() {
+            for (slot, path) in pak.pak.index.paths().iter().enumerate() {
+                lookup.insert(path.clone(), (index, slot));
+            }
+        }
+
+        Ok(PakVfs { paks, lookup })
+    }
+
+    pub fn mount_point(&self) -> &str {
+        self.paks[0].mount_point()
+    }
+
+    pub fn paks(&self) -> &[PakReader] {
+        &self.paks
+    }
+
+    /// Index (into [`PakVfs::paks`]) of the pak that provides `path`, if any.
+    pub fn resolve(&self, path: &str) -> Option<usize> {
+        self.lookup.get(path).map(|&(pak, _)| pak)
+    }
+
+    pub fn contains(&self, path: &str) -> bool {
+        self.lookup.contains_key(path)
+    }
+
+    pub fn len(&self) -> usize {
+        self.lookup.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.lookup.is_empty()
+    }
+
+    /// The merged view: each path with the index of the pak that provides it,
+    /// in no particular order.
+    pub fn iter(&self) -> impl Iterator<Item = (&str, usize)> {
+        self.lookup.iter().map(|(path, &(pak, _))| (path.as_str(), pak))
+    }
+
+    /// Sorted paths of the merged view.
+    pub fn files(&self) -> Vec<String> {
+        let mut files = self.lookup.keys().cloned().collect::<Vec<_>>();
+        files.sort();
+        files
+    }
+
+    /// Reads `path` from whichever pak provides it; `readers` must parallel
+    /// [`PakVfs::paks`].
+    pub fn read_file<R: Read + Seek, W: Write>(
+        &self,
+        path: &str,
+        readers: &mut [R],
+        writer: &mut W,
+    ) -> Result<(), super::Error> {
+        let Some(&(index, slot)) = self.lookup.get(path) else {
+            return Err(super::Error::MissingEntry(path.to_owned()));
+        };
+        let pak = &self.paks[index];
+        let entry = pak.pak.index.entry_at(slot)?;
+        entry.read_file(
+            &mut readers[index],
+            pak.pak.version,
+            &pak.pak.compression,
+            pak.key.as_ref(),
+            writer,
+        )
+    }
+
+    pub fn get<R: Read + Seek>(
+        &self,
+        path: &str,
+        readers: &mut [R],
+    ) -> Result<Vec<u8>, super::Error> {
+        let mut data = Vec::new();
+        self.read_file(path, readers, &mut data)?;
+        Ok(data)
+    }
+}
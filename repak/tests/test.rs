@@ -148,7 +148,7 @@ fn test_read(version: repak::Version, _file_name: &str, bytes: &[u8]) {
     }
 }
 
-fn test_write(_version: repak::Version, _file_name: &str, bytes: &[u8]) {
+fn test_write(_version: repak::Version, file_name: &str, bytes: &[u8]) {
     use aes::cipher::KeyInit;
     use base64::{engine::general_purpose, Engine as _};
     let key = general_purpose::STANDARD
@@ -158,17 +158,23 @@ fn test_write(_version: repak::Version, _file_name: &str, bytes: &[u8]) {
         .and_then(|bytes| aes::Aes256::new_from_slice(bytes).map_err(|_| repak::Error::Aes))
         .unwrap();
 
+    let encrypt_data = file_name.contains("_encrypt.") || file_name.contains("_encrypt_");
+
     let mut reader = std::io::Cursor::new(bytes);
-    let pak_reader = repak::PakReader::new_any(&mut reader, Some(key)).unwrap();
+    let pak_reader = repak::PakReader::new_any(&mut reader, Some(key.clone())).unwrap();
 
     let writer = Cursor::new(vec![]);
     let mut pak_writer = repak::PakWriter::new(
         writer,
-        None,
+        Some(key.clone()),
         pak_reader.version(),
         pak_reader.mount_point().to_owned(),
-        Some(0x205C5A7D),
+        pak_reader.path_hash_seed().or(Some(0x205C5A7D)),
     );
+    pak_writer.set_encrypt_data(encrypt_data).unwrap();
+    pak_writer
+        .set_encrypt_index(file_name.contains("_encryptindex"))
+        .unwrap();
 
     for path in pak_reader.files() {
         let data = pak_reader.get(&path, &mut reader).unwrap();
@@ -177,7 +183,25 @@ fn test_write(_version: repak::Version, _file_name: &str, bytes: &[u8]) {
             .unwrap();
     }
 
-    assert!(pak_writer.write_index().unwrap().into_inner() == reader.into_inner());
+    let out = pak_writer.write_index().unwrap().into_inner();
+    if encrypt_data && file_name.starts_with("pack_v5") {
+        // the v5 fixtures predate UnrealPak filling encryption padding from a
+        // fixed location, so their padding bytes can't be reproduced; settle
+        // for a content roundtrip instead of byte identity
+        let mut out_reader = std::io::Cursor::new(&out[..]);
+        let out_pak = repak::PakReader::new_any(&mut out_reader, Some(key)).unwrap();
+        assert_eq!(pak_reader.files(), out_pak.files());
+        for path in pak_reader.files() {
+            assert_eq!(
+                pak_reader.get(&path, &mut reader).unwrap(),
+                out_pak.get(&path, &mut out_reader).unwrap(),
+                "{path}"
+            );
+            out_pak.verify_entry(&path, &out.as_slice()).unwrap();
+        }
+    } else {
+        assert!(out == reader.into_inner());
+    }
 }
 
 fn test_rewrite_index(_version: repak::Version, _file_name: &str, bytes: &[u8]) {
@@ -203,6 +227,723 @@ fn test_rewrite_index(_version: repak::Version, _file_name: &str, bytes: &[u8])
     assert!(bytes == rewrite);
 }
 
+#[test]
+fn test_lazy_index() {
+    let bytes = include_bytes!("packs/pack_v11.pak");
+    let mut reader = Cursor::new(&bytes[..]);
+    let pak = repak::PakReader::new_any_lazy(&mut reader, None).unwrap();
+    assert_eq!(
+        pak.get("test.txt", &mut reader).unwrap(),
+        include_bytes!("pack/root/test.txt")
+    );
+    assert_eq!(
+        pak.get("directory/nested.txt", &mut reader).unwrap(),
+        include_bytes!("pack/root/directory/nested.txt")
+    );
+}
+
+fn test_write_compressed(version: repak::Version, compression: repak::Compression) {
+    let files = [
+        ("test.txt", &include_bytes!("pack/root/test.txt")[..]),
+        ("test.png", &include_bytes!("pack/root/test.png")[..]),
+        ("zeros.bin", &include_bytes!("pack/root/zeros.bin")[..]),
+        (
+            "directory/nested.txt",
+            &include_bytes!("pack/root/directory/nested.txt")[..],
+        ),
+    ];
+
+    let mut pak_writer = repak::PakWriter::new(
+        Cursor::new(vec![]),
+        None,
+        version,
+        "../mount/point/root/".to_owned(),
+        Some(0x205C5A7D),
+    );
+    pak_writer.set_compression(Some(compression)).unwrap();
+    for (path, data) in files {
+        pak_writer
+            .write_file(path, &mut std::io::Cursor::new(data))
+            .unwrap();
+    }
+    let mut reader = pak_writer.write_index().unwrap();
+
+    let pak_reader = repak::PakReader::new_any(&mut reader, None).unwrap();
+    assert_eq!(pak_reader.version(), version);
+    for (path, data) in files {
+        assert_eq!(
+            pak_reader.get(path, &mut reader).unwrap(),
+            data,
+            "{path} did not round trip"
+        );
+    }
+}
+
+#[test]
+fn test_write_compressed_v5() {
+    test_write_compressed(repak::Version::V5, repak::Compression::Zlib);
+}
+
+#[test]
+fn test_write_compressed_v8b() {
+    test_write_compressed(repak::Version::V8B, repak::Compression::Zlib);
+}
+
+#[test]
+fn test_write_compressed_v11() {
+    test_write_compressed(repak::Version::V11, repak::Compression::Zlib);
+}
+
+#[test]
+fn test_write_compressed_zstd() {
+    test_write_compressed(repak::Version::V11, repak::Compression::Zstd);
+}
+
+#[test]
+fn test_entries() {
+    let bytes = include_bytes!("packs/pack_v11.pak");
+    let mut reader = Cursor::new(&bytes[..]);
+    let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+
+    assert_eq!(pak.len(), 4);
+    let entries = pak
+        .entries()
+        .collect::<Result<Vec<_>, repak::Error>>()
+        .unwrap();
+    // sorted path order, borrowing the index
+    assert_eq!(
+        entries.iter().map(|(path, _)| *path).collect::<Vec<_>>(),
+        ["directory/nested.txt", "test.png", "test.txt", "zeros.bin"]
+    );
+
+    let entry = pak.entry("zeros.bin").unwrap().unwrap();
+    assert_eq!(entry.uncompressed, 2048);
+    assert!(pak.entry("missing.txt").unwrap().is_none());
+}
+
+#[test]
+fn test_extraction_plan() {
+    let files = (0..8)
+        .map(|i| (format!("file_{i}.bin"), vec![i as u8; 3000]))
+        // one entry well past the batch limit, to exercise the oversized path
+        .chain([("file_big.bin".to_owned(), vec![9u8; 25_000])])
+        .collect::<Vec<_>>();
+    let mut writer = repak::PakWriter::new(
+        Cursor::new(vec![]),
+        None,
+        repak::Version::V11,
+        "../../../".to_owned(),
+        Some(0),
+    );
+    for (path, data) in &files {
+        writer
+            .write_file(path, &mut std::io::Cursor::new(data))
+            .unwrap();
+    }
+    let reader = writer.write_index().unwrap();
+    let pak = repak::PakReader::new_any(Cursor::new(reader.get_ref()), None).unwrap();
+
+    // a small batch limit forces several batches; adjacent entries coalesce
+    let batches = pak
+        .plan_extraction(pak.files(), 10_000, 64)
+        .unwrap();
+    assert!(batches.len() > 1 && batches.len() < files.len());
+    assert_eq!(
+        batches.iter().map(|b| b.paths().len()).sum::<usize>(),
+        files.len()
+    );
+    // the oversized entry gets a batch of its own (read_batch streams it
+    // instead of buffering the span); everything else stays within the limit
+    assert!(batches.iter().any(|b| b.paths() == ["file_big.bin"]));
+    for batch in &batches {
+        if batch.paths() == ["file_big.bin"] {
+            assert!(batch.size() > 10_000);
+        } else {
+            assert!(batch.size() <= 10_000);
+        }
+    }
+
+    let dir = std::env::temp_dir().join(format!("repak_plan_test_{}", std::process::id()));
+    std::fs::create_dir_all(&dir).unwrap();
+    for batch in &batches {
+        pak.read_batch(batch, &reader.get_ref().as_slice(), |path| {
+            Ok(std::fs::File::create(dir.join(path))?)
+        })
+        .unwrap();
+    }
+    for (path, data) in &files {
+        assert_eq!(&std::fs::read(dir.join(path)).unwrap(), data);
+    }
+    std::fs::remove_dir_all(&dir).unwrap();
+}
+
+#[test]
+fn test_read_files() {
+    let files = (0..20)
+        .map(|i| (format!("group/asset_{i:02}.bin"), vec![i as u8; 2500]))
+        .collect::<Vec<_>>();
+    let mut writer = repak::PakWriter::new(
+        Cursor::new(vec![]),
+        None,
+        repak::Version::V11,
+        "../../../".to_owned(),
+        Some(0),
+    );
+    writer.set_compression(Some(repak::Compression::Zlib)).unwrap();
+    for (path, data) in &files {
+        writer
+            .write_file(path, &mut std::io::Cursor::new(data))
+            .unwrap();
+    }
+    let reader = writer.write_index().unwrap();
+    let pak = repak::PakReader::new_any(Cursor::new(reader.get_ref()), None).unwrap();
+
+    let dir = std::env::temp_dir().join(format!("repak_read_files_test_{}", std::process::id()));
+    std::fs::create_dir_all(dir.join("group")).unwrap();
+    pak.read_files(pak.files(), &reader.get_ref().as_slice(), |path| {
+        Ok(std::fs::File::create(dir.join(path))?)
+    })
+    .unwrap();
+    for (path, data) in &files {
+        assert_eq!(&std::fs::read(dir.join(path)).unwrap(), data);
+    }
+    std::fs::remove_dir_all(&dir).unwrap();
+
+    assert!(pak
+        .read_files(["missing.bin".to_owned()], &reader.get_ref().as_slice(), |_| Ok(vec![]))
+        .is_err());
+}
+
+#[test]
+fn test_read_files_ordered() {
+    let bytes = include_bytes!("packs/pack_v11_compress.pak");
+    let mut reader = Cursor::new(bytes);
+    let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+
+    // entries arrive in data-offset order, each with its decoded contents
+    let mut seen = vec![];
+    pak.read_files_ordered(pak.files(), &bytes.as_slice(), |path, data| {
+        assert_eq!(data, pak.get(path, &mut reader).unwrap());
+        seen.push(path.to_owned());
+        Ok(())
+    })
+    .unwrap();
+    assert_eq!(seen, pak.files_by_offset().unwrap());
+
+    assert!(pak
+        .read_files_ordered(["missing.bin".to_owned()], &bytes.as_slice(), |_, _| Ok(()))
+        .is_err());
+}
+
+#[test]
+fn test_entries_with_prefix() {
+    let mut writer = repak::PakWriter::new(
+        Cursor::new(vec![]),
+        None,
+        repak::Version::V11,
+        "../../../".to_owned(),
+        Some(0),
+    );
+    for path in ["a.txt", "dir/b.txt", "dir/sub/c.txt", "dirx/d.txt"] {
+        writer
+            .write_file(path, &mut std::io::Cursor::new(b"x"))
+            .unwrap();
+    }
+    let mut reader = writer.write_index().unwrap();
+    let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+
+    let query = |prefix: &str| {
+        pak.entries_with_prefix(prefix)
+            .map(|e| e.map(|(path, _)| path.to_string()))
+            .collect::<Result<Vec<_>, repak::Error>>()
+            .unwrap()
+    };
+
+    assert_eq!(query(""), ["a.txt", "dir/b.txt", "dir/sub/c.txt", "dirx/d.txt"]);
+    // whole components only: "dir" must not match "dirx/"
+    assert_eq!(query("dir"), ["dir/b.txt", "dir/sub/c.txt"]);
+    assert_eq!(query("dir/"), ["dir/b.txt", "dir/sub/c.txt"]);
+    assert_eq!(query("dir/sub"), ["dir/sub/c.txt"]);
+    assert_eq!(query("a.txt"), ["a.txt"]);
+    assert_eq!(query("nope"), Vec::<String>::new());
+}
+
+#[test]
+fn test_verify() {
+    // entry hashes cover the bytes as stored, so even encrypted paks verify
+    // without a key (the index here is unencrypted)
+    for bytes in [
+        &include_bytes!("packs/pack_v5_compress_encrypt.pak")[..],
+        &include_bytes!("packs/pack_v8b_compress.pak")[..],
+        &include_bytes!("packs/pack_v11_compress.pak")[..],
+    ] {
+        let mut reader = Cursor::new(bytes);
+        let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+        pak.verify_index(&mut reader).unwrap();
+        for path in pak.files_by_offset().unwrap() {
+            pak.verify_entry(&path, &bytes).unwrap();
+        }
+    }
+
+    // encrypted index hashes cover the plaintext, so verifying them needs
+    // the key
+    {
+        use aes::cipher::KeyInit;
+        use base64::{engine::general_purpose, Engine as _};
+        let key = general_purpose::STANDARD
+            .decode(AES_KEY)
+            .as_ref()
+            .map_err(|_| repak::Error::Base64)
+            .and_then(|bytes| aes::Aes256::new_from_slice(bytes).map_err(|_| repak::Error::Aes))
+            .unwrap();
+        let bytes = include_bytes!("packs/pack_v11_encrypt_encryptindex.pak");
+        let mut reader = Cursor::new(&bytes[..]);
+        let pak = repak::PakReader::new_any(&mut reader, Some(key)).unwrap();
+        pak.verify_index(&mut reader).unwrap();
+        for path in pak.files_by_offset().unwrap() {
+            pak.verify_entry(&path, &&bytes[..]).unwrap();
+        }
+    }
+
+    // flipping a bit in the first entry's data must be caught
+    let mut corrupt = include_bytes!("packs/pack_v11_compress.pak").to_vec();
+    corrupt[0x60] ^= 0xff;
+    let mut reader = Cursor::new(&corrupt[..]);
+    let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+    let failures = pak
+        .files_by_offset()
+        .unwrap()
+        .iter()
+        .filter(|path| pak.verify_entry(path, &corrupt.as_slice()).is_err())
+        .count();
+    assert_eq!(failures, 1);
+}
+
+#[test]
+fn test_async_read() {
+    // enough of an executor for futures over the blanket sync AsyncReadAt
+    // impl, which never return Pending
+    fn block_on<F: std::future::Future>(fut: F) -> F::Output {
+        use std::task::{Context, Poll, RawWaker, RawWakerVTable, Waker};
+        fn noop(_: *const ()) {}
+        fn clone(p: *const ()) -> RawWaker {
+            RawWaker::new(p, &VTABLE)
+        }
+        static VTABLE: RawWakerVTable = RawWakerVTable::new(clone, noop, noop, noop);
+        let waker = unsafe { Waker::from_raw(RawWaker::new(std::ptr::null(), &VTABLE)) };
+        let mut fut = std::pin::pin!(fut);
+        loop {
+            if let Poll::Ready(out) = fut.as_mut().poll(&mut Context::from_waker(&waker)) {
+                return out;
+            }
+        }
+    }
+
+    let bytes = include_bytes!("packs/pack_v11_compress.pak");
+    let mut reader = Cursor::new(&bytes[..]);
+    let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+    for path in pak.files() {
+        let expected = pak.get(&path, &mut reader).unwrap();
+        assert_eq!(
+            block_on(pak.get_async(&path, &&bytes[..])).unwrap(),
+            expected,
+            "{path}"
+        );
+        // fetch/decode split used when decodes run on a separate pool
+        let fetched = block_on(pak.fetch_file(&path, &&bytes[..])).unwrap();
+        let mut out = vec![];
+        fetched.decode(&mut out).unwrap();
+        assert_eq!(out, expected, "{path}");
+    }
+}
+
+#[test]
+fn test_data_alignment() {
+    let version = repak::Version::V11;
+    let mut writer = repak::PakWriter::new(
+        Cursor::new(vec![]),
+        None,
+        version,
+        "../../../".to_owned(),
+        Some(0),
+    );
+    writer.set_data_alignment(Some(4096)).unwrap();
+    writer
+        .write_file("bulk/a.bin", &mut Cursor::new(vec![1u8; 5000]))
+        .unwrap();
+    writer
+        .write_file("bulk/b.bin", &mut Cursor::new(vec![2u8; 100]))
+        .unwrap();
+    // per-file override packs this one tightly
+    writer
+        .write_file_aligned("small/c.txt", &mut Cursor::new(vec![3u8; 10]), None)
+        .unwrap();
+
+    assert!(writer.set_data_alignment(Some(1000)).is_err());
+
+    let bytes = writer.write_index().unwrap().into_inner();
+    let mut reader = Cursor::new(&bytes[..]);
+    let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+    for path in ["bulk/a.bin", "bulk/b.bin"] {
+        let entry = pak.entry(path).unwrap().unwrap();
+        let payload = entry.offset
+            + repak::Entry::get_serialized_size(
+                version,
+                entry.compression,
+                entry.blocks.as_ref().map_or(0, |b| b.len() as u32),
+            );
+        assert_eq!(payload % 4096, 0, "{path} payload at {payload:#x}");
+    }
+    assert_eq!(pak.get("bulk/a.bin", &mut reader).unwrap(), vec![1u8; 5000]);
+    assert_eq!(pak.get("bulk/b.bin", &mut reader).unwrap(), vec![2u8; 100]);
+    assert_eq!(pak.get("small/c.txt", &mut reader).unwrap(), vec![3u8; 10]);
+}
+
+#[test]
+fn test_dedup() {
+    let build = |dedup: bool| {
+        let mut writer = repak::PakWriter::new(
+            Cursor::new(vec![]),
+            None,
+            repak::Version::V11,
+            "../../../".to_owned(),
+            Some(0),
+        );
+        writer.set_dedup(dedup);
+        for path in ["a/shader.bin", "b/shader.bin", "c/shader.bin"] {
+            writer
+                .write_file(path, &mut Cursor::new(vec![0xAB; 4096]))
+                .unwrap();
+        }
+        writer
+            .write_file("unique.bin", &mut Cursor::new(vec![0xCD; 512]))
+            .unwrap();
+        writer.write_index().unwrap().into_inner()
+    };
+
+    let plain = build(false);
+    let deduped = build(true);
+    // two of the three identical 4096 byte files collapse into index entries
+    assert!(plain.len() - deduped.len() >= 2 * 4096);
+
+    let mut reader = Cursor::new(&deduped[..]);
+    let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+    // repeats point at the first copy's data
+    assert_eq!(
+        pak.entry("a/shader.bin").unwrap().unwrap().offset,
+        pak.entry("c/shader.bin").unwrap().unwrap().offset
+    );
+    for path in ["a/shader.bin", "b/shader.bin", "c/shader.bin"] {
+        assert_eq!(pak.get(path, &mut reader).unwrap(), vec![0xAB; 4096]);
+    }
+    assert_eq!(pak.get("unique.bin", &mut reader).unwrap(), vec![0xCD; 512]);
+}
+
+#[test]
+fn test_vfs() {
+    let build = |files: &[(&str, &str)]| {
+        let mut writer = repak::PakWriter::new(
+            Cursor::new(vec![]),
+            None,
+            repak::Version::V11,
+            "../mount/point/root/".to_owned(),
+            Some(0),
+        );
+        for (path, data) in files {
+            writer
+                .write_file(path, &mut std::io::Cursor::new(data.as_bytes()))
+                .unwrap();
+        }
+        writer.write_index().unwrap()
+    };
+
+    let mut base = build(&[("a.txt", "base-a"), ("b.txt", "base-b")]);
+    let mut patch = build(&[("b.txt", "patch-b"), ("c.txt", "patch-c")]);
+
+    let vfs = repak::PakVfs::new(vec![
+        repak::PakReader::new_any(&mut base, None).unwrap(),
+        repak::PakReader::new_any(&mut patch, None).unwrap(),
+    ])
+    .unwrap();
+
+    assert_eq!(vfs.len(), 3);
+    assert_eq!(vfs.files(), ["a.txt", "b.txt", "c.txt"]);
+    assert_eq!(vfs.resolve("a.txt"), Some(0));
+    assert_eq!(vfs.resolve("b.txt"), Some(1));
+    assert_eq!(vfs.resolve("d.txt"), None);
+
+    let mut readers = [base, patch];
+    assert_eq!(vfs.get("a.txt", &mut readers).unwrap(), b"base-a");
+    // the patch layer shadows the base layer
+    assert_eq!(vfs.get("b.txt", &mut readers).unwrap(), b"patch-b");
+    assert_eq!(vfs.get("c.txt", &mut readers).unwrap(), b"patch-c");
+}
+
+#[test]
+fn test_raw_copy() {
+    // raw transfer of every entry must reproduce the pak byte for byte
+    let bytes = include_bytes!("packs/pack_v11_compress.pak");
+    let mut reader = Cursor::new(&bytes[..]);
+    let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+
+    let mut pak_writer = repak::PakWriter::new(
+        Cursor::new(vec![]),
+        None,
+        repak::Version::V11,
+        pak.mount_point().to_owned(),
+        // the fixture's path hash seed
+        Some(0xD8EC32CB),
+    );
+    let mut paths = pak.files();
+    paths.sort();
+    for path in &paths {
+        let partial = pak.read_raw(path, &mut reader).unwrap();
+        pak_writer.write_partial_entry(path, partial).unwrap();
+    }
+    let out = pak_writer.write_index().unwrap().into_inner();
+    assert_eq!(&bytes[..], &out[..]);
+
+    // raw transfer across versions (and out of encryption) keeps contents
+    let bytes = include_bytes!("packs/pack_v5_compress_encrypt.pak");
+    let mut reader = Cursor::new(&bytes[..]);
+    use aes::cipher::KeyInit;
+    use base64::{engine::general_purpose, Engine as _};
+    let key = aes::Aes256::new_from_slice(
+        &general_purpose::STANDARD.decode(AES_KEY).unwrap(),
+    )
+    .unwrap();
+    let pak = repak::PakReader::new_any(&mut reader, Some(key)).unwrap();
+
+    let mut pak_writer = repak::PakWriter::new(
+        Cursor::new(vec![]),
+        None,
+        repak::Version::V11,
+        pak.mount_point().to_owned(),
+        Some(0x205C5A7D),
+    );
+    for path in pak.files() {
+        let partial = pak.read_raw(&path, &mut reader).unwrap();
+        pak_writer.write_partial_entry(&path, partial).unwrap();
+    }
+    let mut out = pak_writer.write_index().unwrap();
+    let out_pak = repak::PakReader::new_any(&mut out, None).unwrap();
+    assert_eq!(
+        out_pak.get("test.txt", &mut out).unwrap(),
+        include_bytes!("pack/root/test.txt")
+    );
+    assert_eq!(
+        out_pak.get("zeros.bin", &mut out).unwrap(),
+        include_bytes!("pack/root/zeros.bin")
+    );
+}
+
+#[test]
+fn test_write_streaming() {
+    // one file larger than the streaming copy chunk to exercise back-patching
+    // across multiple reads
+    let big = (0..0x40000).map(|i| i as u8).collect::<Vec<_>>();
+    let files = [
+        ("test.txt", &include_bytes!("pack/root/test.txt")[..]),
+        ("big.bin", &big[..]),
+    ];
+
+    let make_writer = || {
+        repak::PakWriter::new(
+            Cursor::new(vec![]),
+            None,
+            repak::Version::V11,
+            "../mount/point/root/".to_owned(),
+            Some(0x205C5A7D),
+        )
+    };
+
+    let mut buffered = make_writer();
+    let mut streamed = make_writer();
+    for (path, data) in files {
+        buffered
+            .write_file(path, &mut std::io::Cursor::new(data))
+            .unwrap();
+        streamed
+            .write_file_streaming(path, &mut std::io::Cursor::new(data))
+            .unwrap();
+    }
+    let buffered = buffered.write_index().unwrap().into_inner();
+    let streamed = streamed.write_index().unwrap().into_inner();
+
+    // streaming must produce byte-identical output to the buffered path
+    assert_eq!(buffered, streamed);
+
+    // same equivalence with entry encryption on; tiny.bin is shorter than
+    // one AES block and test.txt ends in a partial one, exercising the
+    // streamed trailing padding
+    use aes::cipher::KeyInit;
+    use base64::{engine::general_purpose, Engine as _};
+    let key = general_purpose::STANDARD
+        .decode(AES_KEY)
+        .as_ref()
+        .map_err(|_| repak::Error::Base64)
+        .and_then(|bytes| aes::Aes256::new_from_slice(bytes).map_err(|_| repak::Error::Aes))
+        .unwrap();
+    let make_writer = || {
+        let mut writer = repak::PakWriter::new(
+            Cursor::new(vec![]),
+            Some(key.clone()),
+            repak::Version::V11,
+            "../mount/point/root/".to_owned(),
+            Some(0x205C5A7D),
+        );
+        writer.set_encrypt_data(true).unwrap();
+        writer
+    };
+    let files = [
+        ("test.txt", &include_bytes!("pack/root/test.txt")[..]),
+        ("tiny.bin", &b"1234567"[..]),
+        ("big.bin", &big[..]),
+    ];
+    let mut buffered = make_writer();
+    let mut streamed = make_writer();
+    for (path, data) in files {
+        buffered
+            .write_file(path, &mut std::io::Cursor::new(data))
+            .unwrap();
+        streamed
+            .write_file_streaming(path, &mut std::io::Cursor::new(data))
+            .unwrap();
+    }
+    let buffered = buffered.write_index().unwrap().into_inner();
+    let streamed = streamed.write_index().unwrap().into_inner();
+    assert_eq!(buffered, streamed);
+
+    // streaming with encryption requested but no key must fail, not fall
+    // back to plaintext
+    let mut keyless = repak::PakWriter::new(
+        Cursor::new(vec![]),
+        None,
+        repak::Version::V11,
+        "../mount/point/root/".to_owned(),
+        Some(0),
+    );
+    assert!(keyless.set_encrypt_data(true).is_err());
+}
+
+#[test]
+fn test_mmap() {
+    let path = std::env::temp_dir().join(format!("repak_mmap_test_{}.pak", std::process::id()));
+    std::fs::write(&path, include_bytes!("packs/pack_v5.pak")).unwrap();
+    let file = std::fs::File::open(&path).unwrap();
+
+    let pak = repak::MmapPakReader::new_any(&file, None).unwrap();
+    assert_eq!(pak.mount_point(), "../mount/point/root/");
+    assert_eq!(
+        pak.get_ref("test.txt").unwrap().unwrap(),
+        include_bytes!("pack/root/test.txt")
+    );
+    assert_eq!(
+        pak.get("zeros.bin").unwrap(),
+        include_bytes!("pack/root/zeros.bin")
+    );
+
+    drop(pak);
+    std::fs::remove_file(&path).unwrap();
+}
+
+#[test]
+fn test_mmap_compressed() {
+    let path =
+        std::env::temp_dir().join(format!("repak_mmap_test_comp_{}.pak", std::process::id()));
+    std::fs::write(&path, include_bytes!("packs/pack_v5_compress.pak")).unwrap();
+    let file = std::fs::File::open(&path).unwrap();
+
+    let pak = repak::MmapPakReader::new_any(&file, None).unwrap();
+    // compressed entries cannot be borrowed zero-copy
+    assert!(pak.get_ref("zeros.bin").unwrap().is_none());
+    assert_eq!(
+        pak.get("zeros.bin").unwrap(),
+        include_bytes!("pack/root/zeros.bin")
+    );
+
+    drop(pak);
+    std::fs::remove_file(&path).unwrap();
+}
+
+#[test]
+fn test_case_insensitive() {
+    // V11 probes the pak's own path hash index; V5 has none, so enabling
+    // the mode builds the hash -> slot map
+    for bytes in [
+        &include_bytes!("packs/pack_v11.pak")[..],
+        &include_bytes!("packs/pack_v5.pak")[..],
+    ] {
+        let mut reader = Cursor::new(bytes);
+        let mut pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+
+        assert!(pak.get("Directory/NESTED.txt", &mut reader).is_err());
+        pak.set_case_insensitive(true);
+        assert_eq!(
+            pak.get("Directory/NESTED.txt", &mut reader).unwrap(),
+            include_bytes!("pack/root/directory/nested.txt")
+        );
+        // exact-case lookups still hit
+        assert_eq!(
+            pak.get("directory/nested.txt", &mut reader).unwrap(),
+            include_bytes!("pack/root/directory/nested.txt")
+        );
+        assert!(pak.get("directory/missing.txt", &mut reader).is_err());
+
+        pak.set_case_insensitive(false);
+        assert!(pak.get("Directory/NESTED.txt", &mut reader).is_err());
+    }
+}
+
+#[test]
+fn test_stats() {
+    // the stats counters are global and other tests may run concurrently,
+    // so only assert on the deltas this test is guaranteed to contribute
+    let bytes = include_bytes!("packs/pack_v11_compress.pak");
+    let mut reader = Cursor::new(bytes);
+    let pak = repak::PakReader::new_any(&mut reader, None).unwrap();
+
+    // uncompressed size of the entries actually stored compressed (small
+    // files fall back to verbatim storage and never hit the inflate path)
+    let expected_inflated = pak
+        .entries()
+        .map(|entry| {
+            let (_, entry) = entry.unwrap();
+            match entry.compression {
+                Some(_) => entry.uncompressed,
+                None => 0,
+            }
+        })
+        .sum::<u64>();
+    assert!(expected_inflated > 0);
+
+    repak::stats::set_enabled(true);
+    let before = repak::stats::snapshot();
+    for path in pak.files() {
+        pak.get(&path, &mut reader).unwrap();
+    }
+    let after = repak::stats::snapshot();
+    repak::stats::set_enabled(false);
+
+    assert!(after.entry_lookups >= before.entry_lookups + pak.files().len() as u64);
+    assert!(after.read.bytes > before.read.bytes);
+    let inflated = |stats: &repak::stats::Stats| {
+        stats
+            .decompress
+            .iter()
+            .find(|(c, _)| *c == repak::Compression::Zlib)
+            .map_or(0, |(_, p)| p.bytes)
+    };
+    assert!(inflated(&after) >= inflated(&before) + expected_inflated);
+
+    // every decoded byte passes through the output-write timer
+    let expected_written = pak
+        .entries()
+        .map(|entry| entry.unwrap().1.uncompressed)
+        .sum::<u64>();
+    assert!(after.write.bytes >= before.write.bytes + expected_written);
+}
+
 macro_rules! matrix_test {
     ( $name:literal, ($($version:literal $exp_version:expr),* $(,)?), $compress:tt, $encrypt:tt, $encryptindex:tt, $body:tt ) => {
         $( matrix_test_compress!($name, $version, $exp_version, $compress, $encrypt, $encryptindex, $body); )*
@@ -268,8 +1009,8 @@ matrix_test!(
         "v11" repak::Version::V11,
     ),
     ("", /*"_compress"*/),
-    ("", /*"_encrypt"*/),
-    ("", /*"_encryptindex"*/),
+    ("", "_encrypt"),
+    ("", "_encryptindex"),
     test_write
 );
 